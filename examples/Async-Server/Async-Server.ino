@@ -117,11 +117,12 @@ void serverTask(void *params) {
 
     // "loop()" function of the separate task
     while(true) {
-      // This call will let the server do its work
-      secureServer.loop();
+      // This call will let the server do its work. It waits up to 1000ms for
+      // incoming data or new connections, so the task does not need to poll
+      // the server while it is idle.
+      secureServer.loop(1000);
 
       // Other code would go here...
-      delay(1);
     }
   }
 }
@@ -153,6 +153,10 @@ void handleEcho(HTTPRequest * req, HTTPResponse * res) {
     // The response does not only implement the Print interface to
     // write character data to the response but also the write function
     // to write binary data to the response.
+    // If the client reads the response slower than it sends the request,
+    // write waits until it has caught up. The body can only be read while
+    // the handler runs, so it cannot continue the response later with
+    // onWritable() like the other examples do.
     res->write(buffer, s);
   }
 }
@@ -35,6 +35,7 @@
  *    - /api/events allows to register or delete events to turn PINs on/off
  *      at certain times.
  *  - Use Arduino JSON for body parsing and generation of responses.
+ *  - Compress responses for clients that support it, to save bandwidth.
  *  - The certificate is generated on first run and stored to the SPIFFS in
  *    the cert directory (so that the client cannot retrieve the private key)
  */
@@ -77,6 +78,7 @@ char contentTypes[][2][32] = {
 #include <HTTPRequest.hpp>
 #include <HTTPResponse.hpp>
 #include <util.hpp>
+#include <CompressionMiddleware.hpp>
 
 // The HTTPS Server comes in a separate namespace. For easier use, include it here.
 using namespace httpsserver;
@@ -181,6 +183,10 @@ void setup() {
   ResourceNode * deleteEventNode = new ResourceNode("/api/events/*", "DELETE", &handleDeleteEvent);
   secureServer->registerNode(deleteEventNode);
 
+  // Compress the responses (like the JSON of the API or the files from the SPIFFS) with gzip, if the
+  // browser supports it. Small responses and images are sent as they are.
+  secureServer->addMiddleware(&compressionMiddleware);
+
   Serial.println("Starting server...");
   secureServer->start();
   if (secureServer->isRunning()) {
@@ -336,15 +342,20 @@ void handleSPIFFS(HTTPRequest * req, HTTPResponse * res) {
       cTypeIdx+=1;
     } while(strlen(contentTypes[cTypeIdx][0])>0);
 
-    // Read the file and write it to the response
-    uint8_t buffer[256];
-    size_t length = 0;
-    do {
-      length = file.read(buffer, 256);
-      res->write(buffer, length);
-    } while (length > 0);
-
-    file.close();
+    // Read the file and write it to the response whenever the client can take more data. The server
+    // handles the other clients in between, even if this one is on a slow network
+    res->onWritable([res, file]() mutable {
+      uint8_t buffer[256];
+      while (res->availableForWrite() > 0) {
+        size_t length = file.read(buffer, 256);
+        if (length == 0) {
+          file.close();
+          return false;
+        }
+        res->write(buffer, length);
+      }
+      return true;
+    });
   } else {
     // If there's any body, discard it
     req->discardRequestBody();
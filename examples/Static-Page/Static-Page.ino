@@ -11,6 +11,7 @@
  * This script will install an HTTPS Server on your ESP32 with the following
  * functionalities:
  *  - Show simple page on web server root
+ *  - Serve the favicon from flash with a StaticAssetNode
  *  - 404 for everything else
  */
 
@@ -33,6 +34,7 @@
 #include <SSLCert.hpp>
 #include <HTTPRequest.hpp>
 #include <HTTPResponse.hpp>
+#include <StaticAssetNode.hpp>
 
 // The HTTPS Server comes in a separate namespace. For easier use, include it here.
 using namespace httpsserver;
@@ -47,12 +49,18 @@ SSLCert cert = SSLCert(
 // The contstructor takes some more parameters, but we go for default values here.
 HTTPSServer secureServer = HTTPSServer(&cert);
 
+// Files that are served directly from flash: path, content type (NULL to detect it from the file
+// extension), ETag (NULL if none), data and length, followed by data and length of precompressed
+// gzip and brotli variants (if there are any)
+const StaticAsset staticAssets[] = {
+  {"/favicon.ico", "image/vnd.microsoft.icon", "\"favicon-1\"", FAVICON_DATA, FAVICON_LENGTH, NULL, 0, NULL, 0},
+};
+
 // Declare some handler functions for the various URLs on the server
 // The signature is always the same for those functions. They get two parameters,
 // which are pointers to the request data (read request body, headers, ...) and
 // to the response data (write response, set status code, ...)
 void handleRoot(HTTPRequest * req, HTTPResponse * res);
-void handleFavicon(HTTPRequest * req, HTTPResponse * res);
 void handle404(HTTPRequest * req, HTTPResponse * res);
 
 void setup() {
@@ -72,7 +80,8 @@ void setup() {
   // For every resource available on the server, we need to create a ResourceNode
   // The ResourceNode links URL and HTTP method to a handler function
   ResourceNode * nodeRoot    = new ResourceNode("/", "GET", &handleRoot);
-  ResourceNode * nodeFavicon = new ResourceNode("/favicon.ico", "GET", &handleFavicon);
+  // Static files don't need a handler function, the StaticAssetNode sends them from the table above
+  StaticAssetNode * nodeFavicon = new StaticAssetNode("/favicon.ico", staticAssets, 1);
   ResourceNode * node404     = new ResourceNode("", "GET", &handle404);
 
   // Add the root node to the server
@@ -120,13 +129,6 @@ void handleRoot(HTTPRequest * req, HTTPResponse * res) {
   res->println("</html>");
 }
 
-void handleFavicon(HTTPRequest * req, HTTPResponse * res) {
-  // Set Content-Type
-  res->setHeader("Content-Type", "image/vnd.microsoft.icon");
-  // Write data from header file
-  res->write(FAVICON_DATA, FAVICON_LENGTH);
-}
-
 void handle404(HTTPRequest * req, HTTPResponse * res) {
   // Discard request body, if we received any
   // We do this, as this is the default node and may also server POST/PUT requests
@@ -0,0 +1,141 @@
+/**
+ * Example for the ESP32 HTTP(S) Webserver
+ *
+ * IMPORTANT NOTE:
+ * To run this script, your need to
+ *  1) Enter your WiFi SSID and PSK below this comment
+ *
+ * This script will install an HTTP Server on your ESP32 that can be used to
+ * measure how worker tasks (see HTTPServer::setWorkerCount()) affect the
+ * throughput for slow handlers:
+ *  - /cpu?ms=50 keeps the CPU busy for 50ms before it answers
+ *  - /sleep?ms=50 waits for 50ms (like a handler that reads a sensor)
+ *  - / answers right away
+ * The load is generated by extras/benchmark_workers.py, e.g.:
+ *
+ *   python3 extras/benchmark_workers.py --clients 4 --requests 20 http://<ip>/cpu?ms=50
+ *
+ * Flash the sketch once for every value of WORKER_COUNT that you want to
+ * compare (e.g. 0, 1, 2 and 4) and run the script each time. With 0, the
+ * server task processes all connections itself. Note that CPU-bound handlers
+ * can only run on two cores at the same time, while waiting handlers profit
+ * from every additional worker.
+ *
+ * The server does not use TLS, so that the time for the handshakes does not
+ * hide the effect of the workers.
+ */
+
+// TODO: Configure your WiFi here
+#define WIFI_SSID "<your ssid goes here>"
+#define WIFI_PSK  "<your pre-shared key goes here>"
+
+// Number of worker tasks that process the connections
+#define WORKER_COUNT 4
+
+/** Check if we have multiple cores */
+#if CONFIG_FREERTOS_UNICORE
+#define ARDUINO_RUNNING_CORE 0
+#else
+#define ARDUINO_RUNNING_CORE 1
+#endif
+
+// We will use wifi
+#include <WiFi.h>
+
+// Includes for the server
+#include <HTTPServer.hpp>
+#include <HTTPRequest.hpp>
+#include <HTTPResponse.hpp>
+
+// The HTTPS Server comes in a separate namespace. For easier use, include it here.
+using namespace httpsserver;
+
+// Create a server on port 80 that accepts up to 8 clients
+HTTPServer server = HTTPServer(80, 8);
+
+// Declare some handler functions for the various URLs on the server
+void handleRoot(HTTPRequest * req, HTTPResponse * res);
+void handleCpu(HTTPRequest * req, HTTPResponse * res);
+void handleSleep(HTTPRequest * req, HTTPResponse * res);
+
+// We declare a function that will be the entry-point for the task that is going to be
+// created.
+void serverTask(void *params);
+
+void setup() {
+  // For logging
+  Serial.begin(115200);
+
+  // Connect to WiFi
+  Serial.println("Setting up WiFi");
+  WiFi.begin(WIFI_SSID, WIFI_PSK);
+  while (WiFi.status() != WL_CONNECTED) {
+    Serial.print(".");
+    delay(500);
+  }
+  Serial.print("Connected. IP=");
+  Serial.println(WiFi.localIP());
+
+  // The server runs in a separate task, like in the Async-Server example
+  xTaskCreatePinnedToCore(serverTask, "http80", 6144, NULL, 1, NULL, ARDUINO_RUNNING_CORE);
+}
+
+void loop() {
+  delay(5000);
+}
+
+void serverTask(void *params) {
+  server.registerNode(new ResourceNode("/", "GET", &handleRoot));
+  server.registerNode(new ResourceNode("/cpu", "GET", &handleCpu));
+  server.registerNode(new ResourceNode("/sleep", "GET", &handleSleep));
+
+  // The worker count has to be set before the server is started
+  server.setWorkerCount(WORKER_COUNT);
+
+  Serial.println("Starting server...");
+  server.start();
+  if (server.isRunning()) {
+    Serial.print("Server ready, workers: ");
+    Serial.println(WORKER_COUNT);
+
+    while(true) {
+      // With workers, this task only accepts new connections and hands them over
+      server.loop(1000);
+    }
+  }
+}
+
+/**
+ * Returns the value of the "ms" query parameter, or 50
+ */
+unsigned long getDuration(HTTPRequest * req) {
+  std::string ms;
+  if (req->getParams()->getQueryParameter("ms", ms)) {
+    return atol(ms.c_str());
+  }
+  return 50;
+}
+
+void handleRoot(HTTPRequest * req, HTTPResponse * res) {
+  res->setHeader("Content-Type", "text/plain");
+  res->println("Hello World!");
+}
+
+void handleCpu(HTTPRequest * req, HTTPResponse * res) {
+  unsigned long duration = getDuration(req);
+  // Busy loop, so the handler occupies its core like an expensive computation would
+  volatile uint32_t counter = 0;
+  unsigned long start = millis();
+  while (millis() - start < duration) {
+    counter++;
+  }
+  res->setHeader("Content-Type", "text/plain");
+  res->println(counter);
+}
+
+void handleSleep(HTTPRequest * req, HTTPResponse * res) {
+  // Blocks the task that runs the handler, but leaves the CPU to the others
+  delay(getDuration(req));
+  res->setHeader("Content-Type", "text/plain");
+  res->println("Slept");
+}
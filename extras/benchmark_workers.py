@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+"""
+Measures how long a server needs to answer a number of requests from several concurrent clients.
+
+Used with the Worker-Benchmark example to compare different values of HTTPServer::setWorkerCount().
+Each client sends its share of the requests one after the other, each on a new connection (or on a
+single keep-alive connection with --keep-alive). Only the Python standard library is required.
+
+Usage:
+  benchmark_workers.py [options] <url>
+
+Example:
+  benchmark_workers.py --clients 4 --requests 20 http://192.168.1.42/cpu?ms=50
+"""
+
+import argparse
+import http.client
+import sys
+import threading
+import time
+import urllib.parse
+
+
+def run_client(url, count, keep_alive, timeout, latencies, errors, lock):
+  """Sends count requests and records the latency of each successful one"""
+  path = url.path or "/"
+  if url.query:
+    path += "?" + url.query
+  connection_class = http.client.HTTPSConnection if url.scheme == "https" else http.client.HTTPConnection
+  kwargs = {"timeout": timeout}
+  if url.scheme == "https":
+    # The example certificates are self-signed
+    import ssl
+    kwargs["context"] = ssl._create_unverified_context()
+  con = None
+  for _ in range(count):
+    start = time.time()
+    try:
+      if con is None:
+        con = connection_class(url.hostname, url.port, **kwargs)
+      con.request("GET", path, headers={"Connection": "keep-alive" if keep_alive else "close"})
+      res = con.getresponse()
+      res.read()
+      ok = (res.status == 200)
+      if not keep_alive or res.will_close:
+        con.close()
+        con = None
+    except (OSError, http.client.HTTPException):
+      ok = False
+      if con is not None:
+        con.close()
+        con = None
+    with lock:
+      if ok:
+        latencies.append(time.time() - start)
+      else:
+        errors.append(1)
+  if con is not None:
+    con.close()
+
+
+def main():
+  parser = argparse.ArgumentParser(description="Measures the throughput of a server with concurrent clients")
+  parser.add_argument("url", help="URL to request, e.g. http://192.168.1.42/cpu?ms=50")
+  parser.add_argument("--clients", type=int, default=4, help="number of concurrent clients (default: 4)")
+  parser.add_argument("--requests", type=int, default=20, help="total number of requests (default: 20)")
+  parser.add_argument("--keep-alive", action="store_true", help="reuse one connection per client")
+  parser.add_argument("--timeout", type=float, default=10, help="timeout per request in seconds (default: 10)")
+  args = parser.parse_args()
+
+  url = urllib.parse.urlparse(args.url)
+  if url.scheme not in ("http", "https") or not url.hostname:
+    parser.error("the URL has to start with http:// or https://")
+  if args.clients < 1 or args.requests < args.clients:
+    parser.error("at least one request per client is required")
+
+  latencies = []
+  errors = []
+  lock = threading.Lock()
+  # The requests are distributed as evenly as possible
+  counts = [args.requests // args.clients + (1 if i < args.requests % args.clients else 0) for i in range(args.clients)]
+  threads = [threading.Thread(target=run_client, args=(url, count, args.keep_alive, args.timeout, latencies, errors, lock))
+    for count in counts]
+
+  start = time.time()
+  for thread in threads:
+    thread.start()
+  for thread in threads:
+    thread.join()
+  total = time.time() - start
+
+  print("%d requests from %d clients in %.2f s (%.1f requests/s)" % (args.requests, args.clients, total, args.requests / total))
+  if latencies:
+    latencies.sort()
+    print("latency: min %.0f ms, median %.0f ms, max %.0f ms" % (
+      latencies[0] * 1000, latencies[len(latencies) // 2] * 1000, latencies[-1] * 1000))
+  if errors:
+    print("%d requests failed" % len(errors))
+    return 1
+  return 0
+
+
+if __name__ == "__main__":
+  sys.exit(main())
@@ -0,0 +1,265 @@
+#!/usr/bin/env python3
+"""
+Packs a directory of web assets into a C++ header that can be served by a StaticAssetNode.
+
+Each file is minified (where this is safe), compressed with gzip and brotli (if the brotli module
+is installed) and stored as a byte array. The header contains a table of StaticAsset entries that is
+sorted by path, so the node finds entries by binary search. Content type, ETag and the serialized
+response headers of every variant are computed here, so the ESP32 does not need to compress or hash
+anything at runtime.
+
+Usage:
+  pack_assets.py [options] <directory> <output.h>
+
+Example:
+  pack_assets.py --name webAssets data/www src/webassets.h
+
+In the sketch:
+  #include "webassets.h"
+  server.registerNode(new StaticAssetNode("/*", webAssets, webAssetsCount));
+"""
+
+import argparse
+import gzip
+import hashlib
+import json
+import os
+import re
+import sys
+
+try:
+  import brotli
+except ImportError:
+  brotli = None
+
+# Content types by file extension, the same as in StaticAssetNode::getContentType()
+CONTENT_TYPES = {
+  "html": "text/html",
+  "htm": "text/html",
+  "css": "text/css",
+  "js": "application/javascript",
+  "mjs": "application/javascript",
+  "json": "application/json",
+  "map": "application/json",
+  "txt": "text/plain",
+  "xml": "text/xml",
+  "svg": "image/svg+xml",
+  "png": "image/png",
+  "jpg": "image/jpeg",
+  "jpeg": "image/jpeg",
+  "gif": "image/gif",
+  "webp": "image/webp",
+  "ico": "image/x-icon",
+  "woff": "font/woff",
+  "woff2": "font/woff2",
+  "ttf": "font/ttf",
+  "wasm": "application/wasm",
+  "pdf": "application/pdf",
+  "mp3": "audio/mpeg",
+  "mp4": "video/mp4",
+}
+
+# Text types get a charset
+TEXT_TYPES = ("text/", "application/javascript", "application/json", "image/svg+xml")
+
+# These formats are compressed already, another compression would not gain anything
+COMPRESSED_EXTENSIONS = ("png", "jpg", "jpeg", "gif", "webp", "woff", "woff2", "mp3", "mp4", "gz", "br", "zip")
+
+# A compressed variant is only included if it saves at least this fraction of the size
+MIN_SAVING = 0.1
+
+
+def content_type(path):
+  ext = path.rsplit(".", 1)[-1].lower() if "." in os.path.basename(path) else ""
+  ctype = CONTENT_TYPES.get(ext, "application/octet-stream")
+  if ctype.startswith(TEXT_TYPES):
+    ctype += "; charset=utf-8"
+  return ctype
+
+
+def collapse_css(code):
+  # Only used outside of strings. The space before ":" is kept, it makes "div :first-child" a
+  # descendant selector
+  code = re.sub(r" ?([{};,>]) ?", r"\1", code)
+  return code.replace(": ", ":").replace(";}", "}")
+
+
+def minify_css(text):
+  # Strings are kept as they are, comments and runs of whitespace outside of them are removed
+  out = []
+  code = ""
+  pattern = re.compile(r'("(?:\\.|[^"\\])*"|\'(?:\\.|[^\'\\])*\')|(/\*.*?\*/)|(\s+)', re.S)
+  pos = 0
+  for m in pattern.finditer(text):
+    code += text[pos:m.start()]
+    if m.group(1):
+      out.append(collapse_css(code))
+      out.append(m.group(1))
+      code = ""
+    elif m.group(3):
+      code += " "
+    pos = m.end()
+  code += text[pos:]
+  out.append(collapse_css(code))
+  return "".join(out).strip()
+
+
+def minify_html(text):
+  # Whitespace is significant in these elements, and scripts may contain anything, so their content
+  # is kept as it is. Elsewhere, comments and indentation are removed
+  out = []
+  pattern = re.compile(r"<(pre|textarea|script|style)\b.*?</\1\s*>", re.S | re.I)
+  pos = 0
+  for m in list(pattern.finditer(text)) + [None]:
+    markup = text[pos:m.start() if m else len(text)]
+    markup = re.sub(r"<!--(?!\[if).*?-->", "", markup, flags=re.S)
+    out.append(re.sub(r"[ \t\r]*\n\s*", "\n", markup))
+    if m:
+      out.append(m.group(0))
+      pos = m.end()
+  return "".join(out).strip()
+
+
+def minify(path, data):
+  ext = path.rsplit(".", 1)[-1].lower()
+  try:
+    text = data.decode("utf-8")
+  except UnicodeDecodeError:
+    return data
+  if ext == "json":
+    text = json.dumps(json.loads(text), separators=(",", ":"), ensure_ascii=False)
+  elif ext == "css":
+    text = minify_css(text)
+  elif ext in ("html", "htm", "svg"):
+    text = minify_html(text)
+  else:
+    # JavaScript can only be minified safely with a real parser, use your bundler for that
+    return data
+  return text.encode("utf-8")
+
+
+def etag(data):
+  return '"' + hashlib.sha256(data).hexdigest()[:16] + '"'
+
+
+def variant_etag(tag, encoding):
+  # Must match variantETag() in StaticAssetNode.cpp
+  return tag[:-1] + "-" + encoding + '"'
+
+
+def headers(ctype, tag, encoding, has_variants, cache_control):
+  h = "Content-Type: " + ctype + "\r\n"
+  if encoding is not None:
+    h += "Content-Encoding: " + encoding + "\r\n"
+  if has_variants:
+    h += "Vary: Accept-Encoding\r\n"
+  h += "ETag: " + tag + "\r\n"
+  if cache_control:
+    h += "Cache-Control: " + cache_control + "\r\n"
+  return h
+
+
+def c_string(s):
+  return '"' + s.replace("\\", "\\\\").replace('"', '\\"').replace("\r", "\\r").replace("\n", "\\n") + '"'
+
+
+def c_array(name, data):
+  lines = []
+  for i in range(0, len(data), 16):
+    lines.append("  " + ", ".join("0x%02x" % b for b in data[i:i+16]) + ",")
+  return "static constexpr uint8_t %s[%d] = {\n%s\n};\n" % (name, max(len(data), 1), "\n".join(lines) or "  0")
+
+
+def collect(root):
+  files = []
+  for dirpath, dirnames, filenames in os.walk(root):
+    dirnames.sort()
+    for filename in sorted(filenames):
+      if filename.startswith("."):
+        continue
+      full = os.path.join(dirpath, filename)
+      rel = "/" + os.path.relpath(full, root).replace(os.sep, "/")
+      files.append((rel, full))
+  return files
+
+
+def main():
+  parser = argparse.ArgumentParser(description="Packs web assets into a header for StaticAssetNode")
+  parser.add_argument("directory", help="directory with the assets")
+  parser.add_argument("output", help="header file to create")
+  parser.add_argument("--name", default="webAssets", help="name of the table (default: webAssets)")
+  parser.add_argument("--no-minify", action="store_true", help="do not minify HTML, CSS, SVG and JSON")
+  parser.add_argument("--no-gzip", action="store_true", help="do not create gzip variants")
+  parser.add_argument("--no-brotli", action="store_true", help="do not create brotli variants")
+  parser.add_argument("--cache-control", default="", help="value of a Cache-Control header for all assets")
+  args = parser.parse_args()
+
+  if brotli is None and not args.no_brotli:
+    print("Python module 'brotli' not found, brotli variants are skipped (pip install brotli)", file=sys.stderr)
+
+  files = collect(args.directory)
+  # The node compares paths with strcmp, so sort them by their bytes
+  files.sort(key=lambda f: f[0].encode("utf-8"))
+
+  arrays = []
+  entries = []
+  total = 0
+  for idx, (path, full) in enumerate(files):
+    with open(full, "rb") as f:
+      data = f.read()
+    if not args.no_minify:
+      data = minify(path, data)
+
+    ext = path.rsplit(".", 1)[-1].lower()
+    compressible = ext not in COMPRESSED_EXTENSIONS and len(data) > 0
+    gz = None
+    br = None
+    if compressible and not args.no_gzip:
+      gz = gzip.compress(data, 9, mtime=0)
+      if len(gz) > len(data) * (1 - MIN_SAVING):
+        gz = None
+    if compressible and brotli is not None and not args.no_brotli:
+      br = brotli.compress(data, quality=11)
+      if len(br) > len(data) * (1 - MIN_SAVING):
+        br = None
+
+    ctype = content_type(path)
+    tag = etag(data)
+    has_variants = gz is not None or br is not None
+    base = "%s_%d" % (args.name, idx)
+
+    arrays.append("// %s\n" % path)
+    arrays.append(c_array(base, data))
+    fields = [c_string(path), c_string(ctype), c_string(tag), base, str(len(data))]
+    total += len(data)
+    for variant, suffix, encoding in ((gz, "gz", "gzip"), (br, "br", "br")):
+      if variant is not None:
+        arrays.append(c_array(base + "_" + suffix, variant))
+        fields += [base + "_" + suffix, str(len(variant))]
+        total += len(variant)
+      else:
+        fields += ["NULL", "0"]
+    fields.append(c_string(headers(ctype, tag, None, has_variants, args.cache_control)))
+    for variant, encoding in ((gz, "gzip"), (br, "br")):
+      if variant is not None:
+        fields.append(c_string(headers(ctype, variant_etag(tag, encoding), encoding, True, args.cache_control)))
+      else:
+        fields.append("NULL")
+    entries.append("  {" + ", ".join(fields) + "},")
+
+  guard = re.sub(r"[^A-Z0-9]", "_", os.path.basename(args.output).upper()) + "_"
+  with open(args.output, "w") as out:
+    out.write("// Generated by extras/pack_assets.py from %s, do not edit.\n" % args.directory)
+    out.write("#ifndef %s\n#define %s\n\n" % (guard, guard))
+    out.write("#include <StaticAssetNode.hpp>\n\n")
+    out.write("".join(arrays))
+    out.write("\n// Sorted by path, so that the entries can be found by binary search\n")
+    out.write("static constexpr httpsserver::StaticAsset %s[] = {\n%s\n};\n" % (args.name, "\n".join(entries)))
+    out.write("static constexpr size_t %sCount = %d;\n\n" % (args.name, len(entries)))
+    out.write("#endif /* %s */\n" % guard)
+
+  print("%d files, %d bytes in flash" % (len(entries), total))
+
+
+if __name__ == "__main__":
+  main()
@@ -0,0 +1,76 @@
+#include "Completion.hpp"
+
+namespace httpsserver {
+
+/**
+ * Created by the connection. The object is referenced by the connection and by the working task. It
+ * keeps a reference to the wakeup socket, which the working task may signal after the server has
+ * stopped.
+ */
+Completion::Completion(WakeupSocket * wakeup):
+  _wakeup(wakeup) {
+  _state = COMPLETION_PENDING;
+  _refCount = 2;
+  if (_wakeup != NULL) {
+    _wakeup->retain();
+  }
+}
+
+Completion::~Completion() {
+  if (_wakeup != NULL) {
+    _wakeup->release();
+  }
+}
+
+/**
+ * Notifies the server that the work has been done. May be called from any task.
+ *
+ * Returns false if the connection does not wait anymore. In any case, the object must not be used after
+ * this call.
+ */
+bool Completion::complete() {
+  uint8_t expected = COMPLETION_PENDING;
+  bool completed = _state.compare_exchange_strong(expected, COMPLETION_COMPLETED);
+  if (completed && _wakeup != NULL) {
+    // The connection may have seen the new state and closed already, and the server may even have
+    // stopped. The socket stays valid anyway, as this object holds a reference to it
+    _wakeup->signal();
+  }
+  release();
+  return completed;
+}
+
+/**
+ * Returns true once complete() has been called
+ */
+bool Completion::isCompleted() {
+  return _state == COMPLETION_COMPLETED;
+}
+
+/**
+ * Returns true if the connection does not wait anymore, because it has timed out or has been closed.
+ * The working task can use this to skip expensive work, but still has to call complete().
+ */
+bool Completion::isCancelled() {
+  return _state == COMPLETION_CANCELLED;
+}
+
+/**
+ * Stops waiting, unless complete() has been called already. Returns true in that case. Called by the
+ * connection.
+ */
+bool Completion::cancel() {
+  uint8_t expected = COMPLETION_PENDING;
+  return _state.compare_exchange_strong(expected, COMPLETION_CANCELLED);
+}
+
+/**
+ * Drops one reference. The last one deletes the object.
+ */
+void Completion::release() {
+  if (_refCount.fetch_sub(1) == 1) {
+    delete this;
+  }
+}
+
+} /* namespace httpsserver */
@@ -0,0 +1,58 @@
+#ifndef SRC_COMPLETION_HPP_
+#define SRC_COMPLETION_HPP_
+
+#include <Arduino.h>
+#include <atomic>
+
+#include "HTTPSServerConstants.hpp"
+#include "WakeupSocket.hpp"
+
+namespace httpsserver {
+
+/**
+ * \brief Signals the server from another task that some work of a connection has been done
+ *
+ * The object is shared between the connection, which waits for it, and the task that does the work.
+ * It deletes itself when both are done with it. The working task must call complete() exactly once
+ * and must not use the object afterwards.
+ *
+ * See DeferredResponse, and AwaitableCompletion for coroutine handlers.
+ */
+class Completion {
+public:
+  bool complete();
+  bool isCompleted();
+  bool isCancelled();
+
+protected:
+  friend class HTTPConnection;
+  friend class AwaitableCompletion;
+
+  Completion(WakeupSocket * wakeup);
+  virtual ~Completion();
+
+  bool cancel();
+  void release();
+
+private:
+  enum {
+    // complete() has not been called yet
+    COMPLETION_PENDING,
+    // complete() has been called
+    COMPLETION_COMPLETED,
+    // The connection has timed out or has been closed and does not wait anymore
+    COMPLETION_CANCELLED
+  };
+  std::atomic<uint8_t> _state;
+
+  // Number of parties (connection and working task) that still use the object
+  std::atomic<uint8_t> _refCount;
+
+  // Signalled on completion to wake up the task that owns the connection, or NULL. Retained as long as
+  // the object exists
+  WakeupSocket * _wakeup;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_COMPLETION_HPP_ */
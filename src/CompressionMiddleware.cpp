@@ -0,0 +1,10 @@
+#include "CompressionMiddleware.hpp"
+
+namespace httpsserver {
+
+void compressionMiddleware(HTTPRequest * req, HTTPResponse * res, std::function<void()> next) {
+  res->setCompression(req->getHeaderView(HEADER_ID_ACCEPT_ENCODING));
+  next();
+}
+
+}
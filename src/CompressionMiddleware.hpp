@@ -0,0 +1,24 @@
+#ifndef SRC_COMPRESSIONMIDDLEWARE_HPP_
+#define SRC_COMPRESSIONMIDDLEWARE_HPP_
+
+#include <functional>
+
+#include "HTTPRequest.hpp"
+#include "HTTPResponse.hpp"
+#include "HTTPMiddlewareFunction.hpp"
+
+namespace httpsserver {
+
+/**
+ * \brief Middleware function that compresses the responses of all handlers with gzip or deflate, if
+ * the client accepts it
+ *
+ * Register it with server.addMiddleware(&compressionMiddleware). Small responses and formats that are
+ * compressed already are sent as they are, see HTTPResponse::setCompression(). The memory for each
+ * compressed response is defined by HTTPS_COMPRESSION_WINDOW_BITS and HTTPS_COMPRESSION_MEM_LEVEL.
+ */
+void compressionMiddleware(HTTPRequest * req, HTTPResponse * res, std::function<void()> next);
+
+}
+
+#endif /* SRC_COMPRESSIONMIDDLEWARE_HPP_ */
@@ -4,6 +4,8 @@
 #include <Arduino.h>
 #include <IPAddress.h>
 
+#include "HTTPSServerConstants.hpp"
+
 // Required for SSL
 #include "openssl/ssl.h"
 #undef read
@@ -11,6 +13,9 @@
 namespace httpsserver {
 
 class WebsocketHandler;
+class DeferredResponse;
+class Completion;
+class WakeupSocket;
 
 /**
  * \brief Internal class to handle the state of a connection
@@ -23,11 +28,23 @@ public:
   virtual void signalRequestError() = 0;
   virtual void signalClientClose() = 0;
   virtual size_t getCacheSize() = 0;
+  virtual bool canUseChunkedEncoding() = 0;
+  virtual byte * acquireResponseBuffer() = 0;
+  virtual void releaseResponseBuffer(byte * buffer) = 0;
 
   virtual size_t readBuffer(byte* buffer, size_t length) = 0;
   virtual size_t pendingBufferSize() = 0;
 
   virtual size_t writeBuffer(byte* buffer, size_t length) = 0;
+  virtual size_t getOutputSpace() = 0;
+  virtual bool waitForWritable() = 0;
+
+  virtual DeferredResponse * deferResponse(unsigned long timeoutMs) = 0;
+  virtual WakeupSocket * openWakeupSocket() = 0;
+#if HTTPS_COROUTINES
+  virtual void * allocateFrame(size_t size) = 0;
+  virtual Completion * createCompletion() = 0;
+#endif
 
   virtual bool isSecure() = 0;
   virtual void setWebsocketHandler(WebsocketHandler *wsHandler);
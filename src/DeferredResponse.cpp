@@ -0,0 +1,59 @@
+#include "DeferredResponse.hpp"
+
+#include "HTTPResponse.hpp"
+
+namespace httpsserver {
+
+/**
+ * Created by the connection in HTTPResponse::defer(). The object is referenced by the connection and by
+ * the task that completes it.
+ */
+DeferredResponse::DeferredResponse(WakeupSocket * wakeup):
+  Completion(wakeup) {
+  _statusCode = 200;
+  _statusText = "OK";
+}
+
+DeferredResponse::~DeferredResponse() {
+  _headers.clearAll();
+}
+
+void DeferredResponse::setStatusCode(uint16_t statusCode) {
+  _statusCode = statusCode;
+}
+
+void DeferredResponse::setStatusText(std::string const &statusText) {
+  _statusText = statusText;
+}
+
+void DeferredResponse::setHeader(std::string const &name, std::string const &value) {
+  _headers.set(new HTTPHeader(name, value));
+}
+
+/**
+ * Appends data to the body. The body is kept in memory until the response is sent.
+ */
+size_t DeferredResponse::write(const uint8_t *buffer, size_t size) {
+  _body.append((const char *)buffer, size);
+  return size;
+}
+
+size_t DeferredResponse::write(uint8_t b) {
+  _body.push_back((char)b);
+  return 1;
+}
+
+/**
+ * Copies status, headers and body of the completed response to the response of the connection
+ */
+void DeferredResponse::writeTo(HTTPResponse * res) {
+  res->setStatusCode(_statusCode);
+  res->setStatusText(_statusText);
+  std::vector<HTTPHeader *> * headers = _headers.getAll();
+  for (std::vector<HTTPHeader*>::iterator header = headers->begin(); header != headers->end(); ++header) {
+    res->setHeader((*header)->_name, (*header)->_value);
+  }
+  res->write((const uint8_t *)_body.data(), _body.length());
+}
+
+} /* namespace httpsserver */
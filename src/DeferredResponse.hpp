@@ -0,0 +1,57 @@
+#ifndef SRC_DEFERREDRESPONSE_HPP_
+#define SRC_DEFERREDRESPONSE_HPP_
+
+#include <Arduino.h>
+#include <string>
+// Arduino declares it's own min max, incompatible with the stl...
+#undef min
+#undef max
+#undef write
+
+#include "HTTPSServerConstants.hpp"
+#include "HTTPHeaders.hpp"
+#include "HTTPHeader.hpp"
+#include "Completion.hpp"
+
+namespace httpsserver {
+
+class HTTPResponse;
+
+/**
+ * \brief Response that is completed by another task than the one that called the handler
+ *
+ * A handler obtains the response with HTTPResponse::defer() and passes it on, e.g. to a task that
+ * reads a sensor. That task sets status, headers and body like on an HTTPResponse and then calls
+ * complete(), which hands the response back to the server. Until then, the connection waits without
+ * holding up the server.
+ *
+ * Like any Completion, the object is shared between the server and the completing task. The completing
+ * task must call complete() exactly once and must not use the object afterwards.
+ */
+class DeferredResponse : public Print, public Completion {
+public:
+  void setStatusCode(uint16_t statusCode);
+  void setStatusText(std::string const &statusText);
+  void setHeader(std::string const &name, std::string const &value);
+
+  // From Print:
+  size_t write(const uint8_t *buffer, size_t size);
+  size_t write(uint8_t);
+
+private:
+  friend class HTTPConnection;
+
+  DeferredResponse(WakeupSocket * wakeup);
+  virtual ~DeferredResponse();
+
+  void writeTo(HTTPResponse * res);
+
+  uint16_t _statusCode;
+  std::string _statusText;
+  HTTPHeaders _headers;
+  std::string _body;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_DEFERREDRESPONSE_HPP_ */
@@ -0,0 +1,399 @@
+#include "DeflateEncoder.hpp"
+
+namespace httpsserver {
+
+// Shortest and longest match that can be encoded
+static const size_t MIN_MATCH = 3;
+static const size_t MAX_MATCH = 258;
+// Lookahead that is kept so that a match of maximum length can be found at each position
+static const size_t MIN_LOOKAHEAD = MAX_MATCH + MIN_MATCH + 1;
+// A match of this length is taken without looking for longer ones
+static const size_t NICE_MATCH = 128;
+
+// Base values and number of extra bits of the length codes 257..285 and the distance codes 0..29
+static const uint16_t lengthBase[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t lengthExtra[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t distanceBase[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t distanceExtra[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// CRC32 (as used by gzip) for each value of a nibble
+static const uint32_t crcTable[16] = {
+  0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+  0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+};
+
+static uint32_t updateCRC32(uint32_t crc, const uint8_t * data, size_t length) {
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    crc = (crc >> 4) ^ crcTable[crc & 0xf];
+    crc = (crc >> 4) ^ crcTable[crc & 0xf];
+  }
+  return ~crc;
+}
+
+static uint32_t updateAdler32(uint32_t adler, const uint8_t * data, size_t length) {
+  uint32_t a = adler & 0xffff;
+  uint32_t b = adler >> 16;
+  while (length > 0) {
+    // 5552 is the largest number of bytes for which b cannot overflow before the modulo
+    size_t blockLength = length < 5552 ? length : 5552;
+    length -= blockLength;
+    while (blockLength-- > 0) {
+      a += *data++;
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+  return (b << 16) | a;
+}
+
+/**
+ * Huffman codes are sent starting with their most significant bit, so they are reversed before they
+ * are added to the bit buffer
+ */
+static uint16_t reverseBits(uint16_t code, uint8_t length) {
+  static const uint8_t reversedNibbles[16] = {0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15};
+  uint16_t reversed = (reversedNibbles[code & 0xf] << 12) | (reversedNibbles[(code >> 4) & 0xf] << 8) |
+    (reversedNibbles[(code >> 8) & 0xf] << 4) | reversedNibbles[code >> 12];
+  return reversed >> (16 - length);
+}
+
+DeflateEncoder::DeflateEncoder():
+  _format(DEFLATE_GZIP),
+  _window(NULL),
+  _windowSize(0),
+  _strStart(0),
+  _lookahead(0),
+  _head(NULL),
+  _prev(NULL),
+  _hashBits(0),
+  _bitBuffer(0),
+  _bitCount(0),
+  _outLength(0),
+  _checksum(0),
+  _totalIn(0) {
+
+}
+
+DeflateEncoder::~DeflateEncoder() {
+  release();
+}
+
+/**
+ * Allocates the memory of the encoder and writes the header of the stream. windowBits and memLevel
+ * are limited to the ranges 9..15 and 1..9.
+ *
+ * Returns false if the memory could not be allocated.
+ */
+bool DeflateEncoder::begin(DeflateFormat format, uint8_t windowBits, uint8_t memLevel, OutputFunction output) {
+  release();
+  windowBits = (windowBits < 9 ? 9 : (windowBits > 15 ? 15 : windowBits));
+  memLevel = (memLevel < 1 ? 1 : (memLevel > 9 ? 9 : memLevel));
+
+  _format = format;
+  _output = output;
+  _windowSize = 1 << windowBits;
+  _hashBits = memLevel + 7;
+  _window = (uint8_t *)malloc(2 * _windowSize);
+  _prev = (uint16_t *)malloc(_windowSize * sizeof(uint16_t));
+  _head = (uint16_t *)calloc(1 << _hashBits, sizeof(uint16_t));
+  if (_window == NULL || _prev == NULL || _head == NULL) {
+    HTTPS_LOGE("Could not allocate memory for compression");
+    release();
+    return false;
+  }
+  _strStart = 0;
+  _lookahead = 0;
+  _bitBuffer = 0;
+  _bitCount = 0;
+  _outLength = 0;
+  _totalIn = 0;
+
+  if (_format == DEFLATE_GZIP) {
+    // Magic number, method deflate, no flags, no modification time, no extra flags, unknown OS
+    static const uint8_t gzipHeader[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};
+    for (size_t i = 0; i < sizeof(gzipHeader); i++) {
+      putByte(gzipHeader[i]);
+    }
+    _checksum = 0;
+  } else {
+    // Method deflate with the window size, followed by the check bits
+    uint8_t cmf = ((windowBits - 8) << 4) | 8;
+    putByte(cmf);
+    putByte(31 - ((cmf << 8) % 31));
+    _checksum = 1;
+  }
+
+  // All data is sent in blocks with fixed Huffman codes (BFINAL = 0, BTYPE = 01)
+  putBits(2, 3);
+  return true;
+}
+
+/**
+ * Adds data to the stream. Compressed data is passed to the output function whenever enough has
+ * been collected.
+ *
+ * If the encoder has no data that is still to be compressed, up to 2^(windowBits + 1) bytes are
+ * copied before any output is produced.
+ */
+void DeflateEncoder::write(const uint8_t * data, size_t length) {
+  if (_window == NULL) {
+    return;
+  }
+  _checksum = (_format == DEFLATE_GZIP ? updateCRC32(_checksum, data, length) : updateAdler32(_checksum, data, length));
+  _totalIn += length;
+
+  while (length > 0) {
+    if (_strStart >= 2 * _windowSize - MIN_LOOKAHEAD) {
+      slideWindow();
+    }
+    size_t copyLength = 2 * _windowSize - _strStart - _lookahead;
+    if (copyLength > length) {
+      copyLength = length;
+    }
+    memcpy(_window + _strStart + _lookahead, data, copyLength);
+    _lookahead += copyLength;
+    data += copyLength;
+    length -= copyLength;
+    compress(false);
+  }
+}
+
+/**
+ * Compresses all pending data and passes it to the output function, so that the receiver can
+ * decompress everything that has been written so far (like Z_SYNC_FLUSH in zlib)
+ */
+void DeflateEncoder::flush() {
+  if (_window == NULL) {
+    return;
+  }
+  compress(true);
+  // End of block, an empty stored block to align the stream, and the start of the next block
+  putCode(0, 7);
+  putBits(0, 3);
+  alignBits();
+  putByte(0x00);
+  putByte(0x00);
+  putByte(0xff);
+  putByte(0xff);
+  putBits(2, 3);
+  flushOutput();
+}
+
+/**
+ * Compresses all pending data, ends the stream and releases the memory of the encoder
+ */
+void DeflateEncoder::finish() {
+  if (_window == NULL) {
+    return;
+  }
+  compress(true);
+  // End of block, followed by an empty final block
+  putCode(0, 7);
+  putBits(3, 3);
+  putCode(0, 7);
+  alignBits();
+
+  if (_format == DEFLATE_GZIP) {
+    for (int i = 0; i < 32; i += 8) {
+      putByte(_checksum >> i);
+    }
+    for (int i = 0; i < 32; i += 8) {
+      putByte(_totalIn >> i);
+    }
+  } else {
+    for (int i = 24; i >= 0; i -= 8) {
+      putByte(_checksum >> i);
+    }
+  }
+  flushOutput();
+  release();
+}
+
+/**
+ * Encodes the data in the window. Unless all is set, MIN_LOOKAHEAD bytes are kept, so that matches
+ * can be completed with the next data.
+ */
+void DeflateEncoder::compress(bool all) {
+  while (_lookahead >= MIN_LOOKAHEAD || (all && _lookahead > 0)) {
+    size_t distance = 0;
+    size_t matchLength = 0;
+    if (_lookahead >= MIN_MATCH) {
+      matchLength = findMatch(_strStart, distance);
+      insertString(_strStart);
+    }
+
+    if (matchLength > 0) {
+      putMatch(matchLength, distance);
+      // The strings inside of the match are added to the hash chains as well
+      for (size_t i = 1; i < matchLength && _lookahead - i >= MIN_MATCH; i++) {
+        insertString(_strStart + i);
+      }
+      _strStart += matchLength;
+      _lookahead -= matchLength;
+    } else {
+      putSymbol(_window[_strStart]);
+      _strStart++;
+      _lookahead--;
+    }
+  }
+}
+
+/**
+ * Moves the upper half of the window to the lower half to make space for new data
+ */
+void DeflateEncoder::slideWindow() {
+  memcpy(_window, _window + _windowSize, _windowSize);
+  _strStart -= _windowSize;
+
+  // Positions in the lower half are out of reach now and end the chains
+  size_t hashSize = 1 << _hashBits;
+  for (size_t i = 0; i < hashSize; i++) {
+    _head[i] = (_head[i] >= _windowSize ? _head[i] - _windowSize : 0);
+  }
+  for (size_t i = 0; i < _windowSize; i++) {
+    _prev[i] = (_prev[i] >= _windowSize ? _prev[i] - _windowSize : 0);
+  }
+}
+
+uint16_t DeflateEncoder::hash(size_t pos) {
+  uint32_t value = (_window[pos] << 16) | (_window[pos + 1] << 8) | _window[pos + 2];
+  return (value * 2654435761u) >> (32 - _hashBits);
+}
+
+void DeflateEncoder::insertString(size_t pos) {
+  uint16_t h = hash(pos);
+  _prev[pos & (_windowSize - 1)] = _head[h];
+  _head[h] = pos;
+}
+
+/**
+ * Searches the hash chain for the longest match of the data at pos. Returns its length, or 0 if there
+ * is no match of at least MIN_MATCH bytes.
+ */
+size_t DeflateEncoder::findMatch(size_t pos, size_t &distance) {
+  // Matches must stay in reach after the window has been moved
+  size_t maxDistance = _windowSize - MIN_LOOKAHEAD;
+  size_t limit = (pos > maxDistance ? pos - maxDistance : 0);
+  size_t maxLength = (_lookahead < MAX_MATCH ? _lookahead : MAX_MATCH);
+  const uint8_t * current = _window + pos;
+
+  size_t bestLength = MIN_MATCH - 1;
+  size_t chainLength = HTTPS_COMPRESSION_MAX_CHAIN;
+  size_t candidate = _head[hash(pos)];
+  while (candidate > limit && candidate < pos && chainLength-- > 0) {
+    const uint8_t * match = _window + candidate;
+    // Checking the byte that would make the match longer first skips most candidates quickly
+    if (match[bestLength] == current[bestLength] && match[0] == current[0] && match[1] == current[1]) {
+      size_t length = 2;
+      while (length < maxLength && match[length] == current[length]) {
+        length++;
+      }
+      if (length > bestLength) {
+        bestLength = length;
+        distance = pos - candidate;
+        if (length >= maxLength || length >= NICE_MATCH) {
+          break;
+        }
+      }
+    }
+    candidate = _prev[candidate & (_windowSize - 1)];
+  }
+  return (bestLength >= MIN_MATCH ? bestLength : 0);
+}
+
+/**
+ * Writes a literal byte (0..255), the end of block (256) or a length code (257..285) with the fixed
+ * Huffman code
+ */
+void DeflateEncoder::putSymbol(uint16_t symbol) {
+  if (symbol < 144) {
+    putCode(0x30 + symbol, 8);
+  } else if (symbol < 256) {
+    putCode(0x190 + symbol - 144, 9);
+  } else if (symbol < 280) {
+    putCode(symbol - 256, 7);
+  } else {
+    putCode(0xc0 + symbol - 280, 8);
+  }
+}
+
+void DeflateEncoder::putMatch(size_t length, size_t distance) {
+  size_t lengthCode = 28;
+  while (lengthBase[lengthCode] > length) {
+    lengthCode--;
+  }
+  putSymbol(257 + lengthCode);
+  putBits(length - lengthBase[lengthCode], lengthExtra[lengthCode]);
+
+  size_t distanceCode = 29;
+  while (distanceBase[distanceCode] > distance) {
+    distanceCode--;
+  }
+  putCode(distanceCode, 5);
+  putBits(distance - distanceBase[distanceCode], distanceExtra[distanceCode]);
+}
+
+void DeflateEncoder::putCode(uint16_t code, uint8_t length) {
+  putBits(reverseBits(code, length), length);
+}
+
+void DeflateEncoder::putBits(uint32_t value, uint8_t count) {
+  _bitBuffer |= value << _bitCount;
+  _bitCount += count;
+  while (_bitCount >= 8) {
+    putByte(_bitBuffer & 0xff);
+    _bitBuffer >>= 8;
+    _bitCount -= 8;
+  }
+}
+
+/**
+ * Pads the bits that have been written to a full byte
+ */
+void DeflateEncoder::alignBits() {
+  if (_bitCount > 0) {
+    putByte(_bitBuffer & 0xff);
+  }
+  _bitBuffer = 0;
+  _bitCount = 0;
+}
+
+void DeflateEncoder::putByte(uint8_t value) {
+  _outBuffer[_outLength++] = value;
+  if (_outLength == sizeof(_outBuffer)) {
+    flushOutput();
+  }
+}
+
+void DeflateEncoder::flushOutput() {
+  if (_outLength > 0) {
+    _output(_outBuffer, _outLength);
+    _outLength = 0;
+  }
+}
+
+void DeflateEncoder::release() {
+  free(_window);
+  free(_prev);
+  free(_head);
+  _window = NULL;
+  _prev = NULL;
+  _head = NULL;
+}
+
+} /* namespace httpsserver */
@@ -0,0 +1,89 @@
+#ifndef SRC_DEFLATEENCODER_HPP_
+#define SRC_DEFLATEENCODER_HPP_
+
+#include <Arduino.h>
+#include <functional>
+
+#include "HTTPSServerConstants.hpp"
+
+namespace httpsserver {
+
+enum DeflateFormat {
+  /** zlib stream (RFC 1950), used for "Content-Encoding: deflate" */
+  DEFLATE_ZLIB,
+  /** gzip stream (RFC 1952), used for "Content-Encoding: gzip" */
+  DEFLATE_GZIP
+};
+
+/**
+ * \brief Compresses a stream incrementally with the deflate algorithm (RFC 1951)
+ *
+ * The encoder is meant for responses that are generated on the fly. It uses LZ77 with hash chains
+ * and the fixed Huffman codes of deflate, so no block has to be buffered to build code tables and
+ * the memory footprint only depends on two parameters:
+ *
+ * - windowBits (9..15): Matches are searched in the last 2^windowBits bytes. The encoder needs two
+ *   bytes of memory for each byte of the window for the data and two more for the hash chains.
+ * - memLevel (1..9): The hash table has 2^(memLevel + 7) entries of two bytes each.
+ *
+ * Compressed data is passed to the output function in pieces of up to HTTPS_COMPRESSION_OUTPUT_SIZE
+ * bytes.
+ */
+class DeflateEncoder {
+public:
+  typedef std::function<void(const uint8_t * data, size_t length)> OutputFunction;
+
+  DeflateEncoder();
+  virtual ~DeflateEncoder();
+
+  bool begin(DeflateFormat format, uint8_t windowBits, uint8_t memLevel, OutputFunction output);
+  void write(const uint8_t * data, size_t length);
+  void flush();
+  void finish();
+
+private:
+  void compress(bool all);
+  void slideWindow();
+  uint16_t hash(size_t pos);
+  void insertString(size_t pos);
+  size_t findMatch(size_t pos, size_t &distance);
+  void putSymbol(uint16_t symbol);
+  void putMatch(size_t length, size_t distance);
+  void putCode(uint16_t code, uint8_t length);
+  void putBits(uint32_t value, uint8_t count);
+  void alignBits();
+  void putByte(uint8_t value);
+  void flushOutput();
+  void release();
+
+  DeflateFormat _format;
+  OutputFunction _output;
+
+  // Sliding window of 2 * _windowSize bytes. Data before _strStart has been compressed, the
+  // _lookahead bytes after it have not
+  uint8_t * _window;
+  size_t _windowSize;
+  size_t _strStart;
+  size_t _lookahead;
+
+  // Most recent position for each hash value, and the previous position with the same hash for each
+  // position in the window. 0 ends a chain
+  uint16_t * _head;
+  uint16_t * _prev;
+  uint8_t _hashBits;
+
+  // Bits that do not fill a byte yet
+  uint32_t _bitBuffer;
+  uint8_t _bitCount;
+
+  uint8_t _outBuffer[HTTPS_COMPRESSION_OUTPUT_SIZE];
+  size_t _outLength;
+
+  // Checksum of the uncompressed data (CRC32 for gzip, Adler-32 for zlib) and its length
+  uint32_t _checksum;
+  uint32_t _totalIn;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_DEFLATEENCODER_HPP_ */
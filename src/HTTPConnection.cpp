@@ -2,27 +2,116 @@
 
 namespace httpsserver {
 
+#if HTTPS_COROUTINES
+/**
+ * Request and response of a coroutine handler, which have to outlive the call to processState() that
+ * started it. Allocated from the arena of the connection, followed by the frame of the coroutine.
+ */
+struct HTTPConnection::CoroutineContext {
+  CoroutineContext(HTTPConnection * con, ResolvedResource const &resolvedResource):
+    resource(resolvedResource),
+    req(con, con->_httpHeaders, resource.getMatchingNode(), con->_httpMethod, resource.getParams(), con->_httpResource),
+    res(con) {
+  }
+
+  ResolvedResource resource;
+  HTTPRequest req;
+  HTTPResponse res;
+  // Declared last, so the frame is destroyed before the request and response it refers to
+  HTTPCoroutine coroutine;
+};
+#endif
+
 HTTPConnection::HTTPConnection(ResourceResolver * resResolver):
   _resResolver(resResolver) {
   _socket = -1;
   _addrLen = 0;
 
-  _bufferProcessed = 0;
-  _bufferUnusedIdx = 0;
+  _bufferStart = 0;
+  _bufferLength = 0;
+  _bufferTransferred = 0;
 
   _connectionState = STATE_UNDEFINED;
   _clientState = CSTATE_UNDEFINED;
-  _httpHeaders = NULL;
+  _httpHeaders = new HTTPHeaders();
+  _requestArenaUsed = 0;
   _defaultHeaders = NULL;
+  _responseBuffers = NULL;
   _isKeepAlive = false;
+  _isHTTP11 = false;
+  _requestCount = 0;
+  _pipelining = false;
+  _outputBlocked = false;
+  _outputError = false;
   _lastTransmissionTS = millis();
   _shutdownTS = 0;
+  _socketReadable = false;
+  _waitingForInput = false;
+  _deferred = NULL;
+  _deferredTimeout = 0;
+  _wakeup = NULL;
+  _response = NULL;
+#if HTTPS_COROUTINES
+  _coroutine = NULL;
+  _coroutineRunning = false;
+  _coroutineArenaUsed = 0;
+#endif
   _wsHandler = nullptr;
 }
 
 HTTPConnection::~HTTPConnection() {
   // Close the socket
   closeConnection();
+  delete _httpHeaders;
+}
+
+/**
+ * Resets a closed connection to the state it had after construction, so that initialize() can be
+ * called again. Used by servers that keep a pool of connection objects.
+ *
+ * Buffers and header storage are kept, so reusing the connection does not allocate memory.
+ */
+void HTTPConnection::reset() {
+  _socket = -1;
+  _addrLen = 0;
+
+  _bufferStart = 0;
+  _bufferLength = 0;
+  _bufferTransferred = 0;
+
+  _connectionState = STATE_UNDEFINED;
+  _clientState = CSTATE_UNDEFINED;
+  _httpHeaders->clearAll();
+  _defaultHeaders = NULL;
+  _responseBuffers = NULL;
+  _isKeepAlive = false;
+  _isHTTP11 = false;
+  _requestCount = 0;
+  _pipelining = false;
+  _outputBlocked = false;
+  _outputError = false;
+  _lastTransmissionTS = millis();
+  _shutdownTS = 0;
+  _socketReadable = false;
+  _waitingForInput = false;
+  _deferred = NULL;
+  _wakeup = NULL;
+  _response = NULL;
+#if HTTPS_COROUTINES
+  _coroutine = NULL;
+  _coroutineRunning = false;
+  _coroutineArenaUsed = 0;
+#endif
+
+  // clear() keeps the capacity of the strings
+  _requestArenaUsed = 0;
+  _parserLine.length = 0;
+  _parserLine.parsingFinished = false;
+  _parserLine.overflow = false;
+  _parserLine.overflowText.clear();
+  _httpMethod.clear();
+  _httpResource.clear();
+  _outputQueue.clear();
 }
 
 /**
@@ -30,17 +119,19 @@ HTTPConnection::~HTTPConnection() {
  *
  * The call WILL BLOCK if accept(serverSocketID) blocks. So use select() to check for that in advance.
  */
-int HTTPConnection::initialize(int serverSocketID, HTTPHeaders *defaultHeaders) {
+int HTTPConnection::initialize(int serverSocketID, std::string const *defaultHeaders, ResponseBufferPool *responseBuffers) {
   if (_connectionState == STATE_UNDEFINED) {
     _defaultHeaders = defaultHeaders;
+    _responseBuffers = responseBuffers;
     _addrLen = sizeof(_sockAddr);
     _socket = accept(serverSocketID, (struct sockaddr * )&_sockAddr, &_addrLen);
 
     // Build up SSL Connection context if the socket has been created successfully
     if (_socket >= 0) {
       HTTPS_LOGI("New connection. Socket FID=%d", _socket);
+      // Writes must not block the server if the client does not read, see writeBuffer()
+      setNonBlocking(true);
       _connectionState = STATE_INITIAL;
-      _httpHeaders = new HTTPHeaders();
       refreshTimeout();
       return _socket;
     }
@@ -76,11 +167,30 @@ IPAddress HTTPConnection::getClientIP() {
  * (Should be checkd in the loop and transition should go to CONNECTION_CLOSE if exceeded)
  */
 bool HTTPConnection::isTimeoutExceeded() {
-  return _lastTransmissionTS + HTTPS_CONNECTION_TIMEOUT < millis();
+  // Websocket connections are kept open as long as the client does not close them and reads what is
+  // sent to it
+  if (_connectionState == STATE_WEBSOCKET && _outputQueue.empty()) {
+    return false;
+  }
+  return _lastTransmissionTS + getTimeout() < millis();
 }
 
 /**
- * Resets the timeout to allow again the full HTTPS_CONNECTION_TIMEOUT milliseconds
+ * Returns the time (ms) the connection may stay without any transmission. A keep-alive connection that
+ * waits for the next request uses the shorter HTTPS_KEEPALIVE_TIMEOUT.
+ */
+unsigned long HTTPConnection::getTimeout() {
+  if (_connectionState == STATE_DEFERRED) {
+    return _deferredTimeout;
+  }
+  if (_connectionState == STATE_INITIAL && _requestCount > 0 && _bufferLength == 0 && _parserLine.length == 0) {
+    return HTTPS_KEEPALIVE_TIMEOUT;
+  }
+  return HTTPS_CONNECTION_TIMEOUT;
+}
+
+/**
+ * Resets the timeout to allow again the full timeout (see getTimeout())
  */
 void HTTPConnection::refreshTimeout() {
   _lastTransmissionTS = millis();
@@ -100,12 +210,129 @@ bool HTTPConnection::isError() {
   return (_connectionState == STATE_ERROR);
 }
 
+/**
+ * Returns the socket file descriptor of the connection, or -1 if there is none.
+ */
+int HTTPConnection::getSocket() {
+  return _socket;
+}
+
+/**
+ * Returns true, if calling loop() would make progress without new data arriving on the socket.
+ *
+ * The server only calls loop() for connections that either need processing or for which its
+ * readiness poll reported data on the socket.
+ */
+bool HTTPConnection::needsProcessing() {
+  if (isClosed()) {
+    return false;
+  }
+  // Timeouts have to be handled even if the client does not send anything
+  if (isTimeoutExceeded() || (_connectionState == STATE_CLOSING && _shutdownTS + HTTPS_SHUTDOWN_TIMEOUT < millis())) {
+    return true;
+  }
+  // Data that has already been received by the TLS layer is not visible to the poll
+  if (pendingByteCount() > 0) {
+    return true;
+  }
+  // A connection with a deferred response only continues once the response has been completed
+  if (_connectionState == STATE_DEFERRED) {
+    return _deferred->isCompleted();
+  }
+#if HTTPS_COROUTINES
+  // The same applies to a coroutine handler and what it awaits
+  if (_connectionState == STATE_COROUTINE) {
+    return _coroutine->coroutine.canResume();
+  }
+#endif
+  // A handler that continues its response does so whenever the output queue has space
+  if (_connectionState == STATE_STREAMING) {
+    return _outputQueue.length() < HTTPS_OUTPUT_QUEUE_SIZE;
+  }
+  // Other tasks may have queued messages for a websocket
+  if (_connectionState == STATE_WEBSOCKET && _wsHandler != NULL && _wsHandler->canSendQueuedMessages()) {
+    return true;
+  }
+  // A connection that still has output queued waits for the socket to become writable
+  return !_waitingForInput || (_clientState == CSTATE_CLOSED && _outputQueue.empty());
+}
+
+/**
+ * Returns the number of milliseconds until a timeout of this connection has to be handled.
+ *
+ * The server uses this value to limit how long it waits for socket events.
+ */
+unsigned long HTTPConnection::millisUntilTimeout() {
+  if (isClosed() || (_connectionState == STATE_WEBSOCKET && _outputQueue.empty())) {
+    return ULONG_MAX;
+  }
+  unsigned long now = millis();
+  unsigned long deadline = _lastTransmissionTS + getTimeout();
+  if (_connectionState == STATE_CLOSING && _shutdownTS + HTTPS_SHUTDOWN_TIMEOUT < deadline) {
+    deadline = _shutdownTS + HTTPS_SHUTDOWN_TIMEOUT;
+  }
+  // The timeout checks use "<", so we have to wait one millisecond longer than the deadline itself
+  return deadline < now ? 0 : deadline - now + 1;
+}
+
+/**
+ * Called by the server if its readiness poll reported data on the socket of this connection
+ */
+void HTTPConnection::signalSocketReadable() {
+  _socketReadable = true;
+}
+
+/**
+ * Returns false, if the connection does not process input right now, so the server does not need to
+ * watch its socket for reading. Data that the client sends meanwhile stays in the socket.
+ */
+bool HTTPConnection::waitsForReadable() {
+  // With a full receive buffer, nothing could be read anyway (e.g. while a coroutine handler waits for
+  // something else than the body, and the client has sent its next requests already)
+  return _connectionState != STATE_DEFERRED && _bufferLength < HTTPS_CONNECTION_DATA_CHUNK_SIZE;
+}
+
+/**
+ * Returns true, if the connection cannot make progress until its socket becomes writable.
+ */
+bool HTTPConnection::waitsForWritable() {
+  return !_outputQueue.empty();
+}
+
+/**
+ * Sets the socket that is signalled when a deferred response of this connection is completed. It has
+ * to be watched by the task that processes the connection.
+ */
+void HTTPConnection::setWakeupSocket(WakeupSocket * wakeup) {
+  _wakeup = wakeup;
+}
+
+/**
+ * Switches the socket of this connection between blocking and non-blocking mode
+ */
+void HTTPConnection::setNonBlocking(bool nonBlocking) {
+  int flags = fcntl(_socket, F_GETFL, 0);
+  if (flags >= 0) {
+    fcntl(_socket, F_SETFL, nonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+  }
+}
+
+/**
+ * Advances the handshake of the connection while it is in STATE_HANDSHAKE.
+ *
+ * Plain HTTP connections do not have a handshake, subclasses like HTTPSConnection override this.
+ */
+void HTTPConnection::continueHandshake() {
+  _connectionState = STATE_INITIAL;
+}
+
 bool HTTPConnection::isSecure() {
   return false;
 }
 
 void HTTPConnection::closeConnection() {
   // TODO: Call an event handler here, maybe?
+  flushOutput();
 
   if (_connectionState != STATE_ERROR && _connectionState != STATE_CLOSED) {
 
@@ -131,11 +358,17 @@ void HTTPConnection::closeConnection() {
     _connectionState = STATE_CLOSED;
   }
 
-  if (_httpHeaders != NULL) {
-    HTTPS_LOGD("Free headers");
-    delete _httpHeaders;
-    _httpHeaders = NULL;
-  }
+  // The header storage is kept for the next connection
+  _httpHeaders->clearAll();
+
+  // A deferred response that is completed from now on is discarded
+  releaseDeferredResponse();
+  // So is the rest of a response that a handler continues
+  releaseResponse();
+#if HTTPS_COROUTINES
+  // A coroutine handler that has not returned yet is destroyed
+  releaseCoroutine();
+#endif
 
   if (_wsHandler != nullptr) {
     HTTPS_LOGD("Free WS Handler");
@@ -145,71 +378,28 @@ void HTTPConnection::closeConnection() {
 }
 
 /**
- * This method will try to fill up the buffer with data from
+ * This method will try to fill up the buffer with data from the socket
+ *
+ * The receive buffer is used as a ring buffer: _bufferStart is the index of the first byte that has not
+ * been processed yet, followed by _bufferLength bytes of data, possibly wrapping around at the end.
  */
 int HTTPConnection::updateBuffer() {
   if (!isClosed()) {
 
-    // If there is buffer data that has been marked as processed.
-    // Some example is shown here:
-    //
-    // Previous configuration:
-    // GET / HTTP/1.1\\Host: test\\Foo: bar\\\\[some uninitialized memory]
-    //                 ^ processed             ^ unusedIdx
-    //
-    // New configuration after shifting:
-    // Host: test\\Foo: bar\\\\[some uninitialized memory]
-    // ^ processed             ^ unusedIdx
-    if (_bufferProcessed > 0) {
-      for(int i = 0; i < HTTPS_CONNECTION_DATA_CHUNK_SIZE; i++) {
-        int copyFrom = i + _bufferProcessed;
-        if (copyFrom < _bufferUnusedIdx) {
-          _receiveBuffer[i] = _receiveBuffer[copyFrom];
-        } else {
-          break;
-        }
-      }
-      _bufferUnusedIdx -= _bufferProcessed;
-      _bufferProcessed = 0;
-
-    }
-
-    if (_bufferUnusedIdx < HTTPS_CONNECTION_DATA_CHUNK_SIZE) {
+    if (_bufferLength < HTTPS_CONNECTION_DATA_CHUNK_SIZE) {
       if (canReadData()) {
 
         HTTPS_LOGD("Data on Socket FID=%d", _socket);
 
-        int readReturnCode;
-
-        // The return code of SSL_read means:
-        // > 0 : Length of the data that has been read
-        // < 0 : Error
-        // = 0 : Connection closed
-        readReturnCode = readBytesToBuffer(
-            // Only after the part of the buffer that has not been processed yet
-            (byte*)(_receiveBuffer + sizeof(char) * _bufferUnusedIdx),
-            // Only append up to the end of the buffer
-            HTTPS_CONNECTION_DATA_CHUNK_SIZE - _bufferUnusedIdx
-        );
-
+        // Only append to the contiguous free space. If the free space wraps around, the remainder will be
+        // filled by the next call
+        char * freeSpace;
+        size_t freeLength = getBufferFreeSpan(freeSpace);
+        int readReturnCode = receiveData((byte*)freeSpace, freeLength);
         if (readReturnCode > 0) {
-          _bufferUnusedIdx += readReturnCode;
-          refreshTimeout();
-          return readReturnCode;
-
-        } else if (readReturnCode == 0) {
-          // The connection has been closed by the client
-          _clientState = CSTATE_CLOSED;
-          HTTPS_LOGI("Client closed connection, FID=%d", _socket);
-          // TODO: If we are in state websocket, we might need to do something here
-          return 0;
-        } else {
-          // An error occured
-          _connectionState = STATE_ERROR;
-          HTTPS_LOGE("An receive error occured, FID=%d", _socket);
-          closeConnection();
-          return -1;
+          _bufferLength += readReturnCode;
         }
+        return readReturnCode;
 
       } // data pending
 
@@ -218,7 +408,104 @@ int HTTPConnection::updateBuffer() {
   return 0;
 }
 
+/**
+ * Reads data from the socket into the given buffer and handles the result of the read operation
+ *
+ * Returns the number of bytes that have been read, 0 if the client closed the connection and -1 if no
+ * data could be read, either because of an error or because the read would block.
+ */
+int HTTPConnection::receiveData(byte* buffer, size_t length) {
+  // The return code of SSL_read means:
+  // > 0 : Length of the data that has been read
+  // < 0 : Error
+  // = 0 : Connection closed
+  int readReturnCode = readBytesToBuffer(buffer, length);
+  // The readiness information from the server's poll has been consumed
+  _socketReadable = false;
+
+  if (readReturnCode > 0) {
+    _bufferTransferred += readReturnCode;
+    refreshTimeout();
+    return readReturnCode;
+
+  } else if (readReturnCode == 0) {
+    // The connection has been closed by the client
+    _clientState = CSTATE_CLOSED;
+    HTTPS_LOGI("Client closed connection, FID=%d", _socket);
+    // TODO: If we are in state websocket, we might need to do something here
+    return 0;
+  } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+    // The socket is non-blocking and there is nothing to read yet (e.g. only a part of a TLS record
+    // has been received)
+    return -1;
+  } else {
+    // An error occured
+    _connectionState = STATE_ERROR;
+    HTTPS_LOGE("An receive error occured, FID=%d", _socket);
+    closeConnection();
+    return -1;
+  }
+}
+
+/**
+ * Sets data to the first unprocessed byte in the receive buffer and returns the number of bytes that
+ * can be read from there without wrapping around
+ */
+size_t HTTPConnection::getBufferDataSpan(char *&data) {
+  data = _receiveBuffer + _bufferStart;
+  size_t spanLength = HTTPS_CONNECTION_DATA_CHUNK_SIZE - _bufferStart;
+  return (_bufferLength < spanLength ? _bufferLength : spanLength);
+}
+
+/**
+ * Sets freeSpace to the first free byte in the receive buffer and returns the number of bytes that
+ * can be written from there without wrapping around
+ */
+size_t HTTPConnection::getBufferFreeSpan(char *&freeSpace) {
+  size_t freeStart = _bufferStart + _bufferLength;
+  if (freeStart >= HTTPS_CONNECTION_DATA_CHUNK_SIZE) {
+    freeStart -= HTTPS_CONNECTION_DATA_CHUNK_SIZE;
+    freeSpace = _receiveBuffer + freeStart;
+    return _bufferStart - freeStart;
+  }
+  freeSpace = _receiveBuffer + freeStart;
+  return HTTPS_CONNECTION_DATA_CHUNK_SIZE - freeStart;
+}
+
+/**
+ * Returns the byte at the given offset from the first unprocessed byte in the receive buffer
+ */
+char HTTPConnection::getBufferByte(size_t offset) {
+  size_t idx = _bufferStart + offset;
+  if (idx >= HTTPS_CONNECTION_DATA_CHUNK_SIZE) {
+    idx -= HTTPS_CONNECTION_DATA_CHUNK_SIZE;
+  }
+  return _receiveBuffer[idx];
+}
+
+/**
+ * Marks the given number of bytes at the beginning of the receive buffer as processed
+ */
+void HTTPConnection::consumeBuffer(size_t length) {
+  _bufferLength -= length;
+  _bufferTransferred += length;
+  if (_bufferLength == 0) {
+    // Start at the beginning again, so that the next read can use the whole buffer at once
+    _bufferStart = 0;
+  } else {
+    _bufferStart += length;
+    if (_bufferStart >= HTTPS_CONNECTION_DATA_CHUNK_SIZE) {
+      _bufferStart -= HTTPS_CONNECTION_DATA_CHUNK_SIZE;
+    }
+  }
+}
+
 bool HTTPConnection::canReadData() {
+  // The server has already polled the socket for this loop() call
+  if (_socketReadable) {
+    return true;
+  }
+
   fd_set sockfds;
   FD_ZERO( &sockfds );
   FD_SET(_socket, &sockfds);
@@ -237,80 +524,278 @@ bool HTTPConnection::canReadData() {
 }
 
 size_t HTTPConnection::readBuffer(byte* buffer, size_t length) {
-  updateBuffer();
-  size_t bufferSize = _bufferUnusedIdx - _bufferProcessed;
-
-  if (length > bufferSize) {
-    length = bufferSize;
+  // Large reads go directly from the socket to the caller if there is no buffered data left
+  if (_bufferLength == 0 && length >= HTTPS_CONNECTION_DATA_CHUNK_SIZE / 2) {
+    if (!isClosed() && canReadData()) {
+      int readReturnCode = receiveData(buffer, length);
+      return (readReturnCode > 0 ? readReturnCode : 0);
+    }
+    return 0;
   }
 
-  // Write until length is reached (either by param of by empty buffer
-  for(int i = 0; i < length; i++) {
-    buffer[i] = _receiveBuffer[_bufferProcessed++];
+  updateBuffer();
+  size_t bytesRead = 0;
+
+  // Copy the contiguous parts of the buffer until length is reached or the buffer is empty
+  while(bytesRead < length && _bufferLength > 0) {
+    char * data;
+    size_t spanLength = getBufferDataSpan(data);
+    if (spanLength > length - bytesRead) {
+      spanLength = length - bytesRead;
+    }
+    memcpy(buffer + bytesRead, data, spanLength);
+    bytesRead += spanLength;
+    consumeBuffer(spanLength);
   }
 
-  return length;
+  return bytesRead;
 }
 
 size_t HTTPConnection::pendingBufferSize() {
   updateBuffer();
 
-  return _bufferUnusedIdx - _bufferProcessed + pendingByteCount();
+  return _bufferLength + pendingByteCount();
 }
 
 size_t HTTPConnection::pendingByteCount() {
   return 0; // FIXME: Add the value of the equivalent function of SSL_pending() here
 }
 
+/**
+ * Sends data to the client without waiting for it.
+ *
+ * As long as nothing is queued, the data is written to the socket directly. What the socket does not
+ * accept right away is appended to the output queue and sent when the socket becomes writable (see
+ * flushOutput()). While pipelined requests are answered, the responses are collected in the queue and
+ * sent together with the responses to the following requests.
+ *
+ * All of the data is taken, so that callers can always complete what they have started, like a chunk
+ * or a websocket frame. Callers that produce an unbounded amount of data check getOutputSpace() first,
+ * so the queue only grows beyond HTTPS_OUTPUT_QUEUE_SIZE by a single write. If the client does not
+ * read it, the connection times out.
+ */
 size_t HTTPConnection::writeBuffer(byte* buffer, size_t length) {
-  return send(_socket, buffer, length, 0);
+  if (_outputError) {
+    return 0;
+  }
+  size_t written = 0;
+  if (_outputQueue.empty() && (!_pipelining || length >= HTTPS_OUTPUT_QUEUE_SIZE)) {
+    // Nothing is queued, so the data can be written to the socket directly
+    while (written < length) {
+      int sent = writeSocket(buffer + written, length - written);
+      if (sent < 0) {
+        signalWriteError();
+        return written;
+      } else if (sent == 0) {
+        _outputBlocked = true;
+        break;
+      }
+      written += sent;
+      refreshTimeout();
+    }
+  }
+
+  if (written < length) {
+    if (_outputQueue.empty()) {
+      // The client gets the full timeout to read the data that is queued now
+      refreshTimeout();
+    }
+    if (_outputQueue.capacity() < HTTPS_OUTPUT_QUEUE_SIZE) {
+      _outputQueue.reserve(HTTPS_OUTPUT_QUEUE_SIZE);
+    }
+    _outputQueue.append((char*)buffer + written, length - written);
+  }
+
+  // The response to the last of the pipelined requests is sent right away, together with the collected
+  // data. Otherwise, a handler that streams its response would be delayed. If the socket did not accept
+  // data before, the queue is sent by loop() once it becomes writable
+  if (!_outputBlocked && (!_pipelining || _outputQueue.length() >= HTTPS_OUTPUT_QUEUE_SIZE)) {
+    flushOutput();
+  }
+  return length;
+}
+
+/**
+ * Writes data to the socket without blocking.
+ *
+ * Returns the number of bytes that have been written, 0 if the socket cannot take any data right now,
+ * and -1 on error.
+ */
+int HTTPConnection::writeSocket(byte* buffer, size_t length) {
+  int res = send(_socket, buffer, length, 0);
+  if (res < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return 0;
+  }
+  return res;
+}
+
+/**
+ * Sends as much of the output queue as the socket accepts without blocking. Returns true if the queue
+ * is empty afterwards.
+ */
+bool HTTPConnection::flushOutput() {
+  while (!_outputQueue.empty()) {
+    HTTPS_LOGD("Sending %u queued bytes, FID=%d", _outputQueue.length(), _socket);
+    int sent = writeSocket((byte*)_outputQueue.data(), _outputQueue.length());
+    if (sent < 0) {
+      signalWriteError();
+    } else if (sent == 0) {
+      _outputBlocked = true;
+      return false;
+    } else {
+      // erase() keeps the capacity, so the queue is not reallocated
+      _outputQueue.erase(0, sent);
+      refreshTimeout();
+    }
+  }
+  if (_outputQueue.capacity() > HTTPS_OUTPUT_QUEUE_SIZE) {
+    // A single write has exceeded the size of the queue, its memory is not kept
+    std::string().swap(_outputQueue);
+  }
+  _outputBlocked = false;
+  return true;
+}
+
+/**
+ * Returns the number of bytes that can be added to the output queue before it is full. Responses that
+ * must not wait and websocket messages sent with trySend() do not add data while this is 0.
+ */
+size_t HTTPConnection::getOutputSpace() {
+  if (_outputError || _socket < 0) {
+    return 0;
+  }
+  flushOutput();
+  return (_outputQueue.length() < HTTPS_OUTPUT_QUEUE_SIZE ? HTTPS_OUTPUT_QUEUE_SIZE - _outputQueue.length() : 0);
+}
+
+/**
+ * Waits until the output queue has space again. Returns false if the connection times out before.
+ *
+ * Only used by responses whose handler writes without checking for space, because it expects all data
+ * to be sent. The other connections of the task are not served meanwhile, so handlers that send large
+ * bodies use HTTPResponse::onWritable() instead.
+ */
+bool HTTPConnection::waitForWritable() {
+  while (getOutputSpace() == 0) {
+    if (_outputError) {
+      return false;
+    }
+    unsigned long now = millis();
+    unsigned long deadline = _lastTransmissionTS + HTTPS_CONNECTION_TIMEOUT;
+    if (deadline <= now) {
+      // The queue is full and the client does not read anything
+      HTTPS_LOGW("Timeout while sending data, FID=%d", _socket);
+      signalWriteError();
+      return false;
+    }
+
+    fd_set writefds;
+    FD_ZERO(&writefds);
+    FD_SET(_socket, &writefds);
+
+    timeval timeout;
+    timeout.tv_sec  = (deadline - now) / 1000;
+    timeout.tv_usec = ((deadline - now) % 1000) * 1000;
+
+    select(_socket + 1, NULL, &writefds, NULL, &timeout);
+  }
+  return true;
+}
+
+/**
+ * Called if writing to the socket failed. The client is gone, so the output is discarded.
+ */
+void HTTPConnection::signalWriteError() {
+  HTTPS_LOGW("Could not send data, FID=%d", _socket);
+  _outputError = true;
+  _outputBlocked = false;
+  _outputQueue.clear();
+  _clientState = CSTATE_CLOSED;
 }
 
 size_t HTTPConnection::readBytesToBuffer(byte* buffer, size_t length) {
   return recv(_socket, buffer, length, MSG_WAITALL | MSG_DONTWAIT);
 }
 
-void HTTPConnection::raiseError(uint16_t code, std::string reason) {
+/**
+ * Error responses that are used frequently, serialized at compile time
+ */
+#define HTTPS_ERROR_RESPONSE(code, reason) \
+  { code, "HTTP/1.1 " #code " " reason "\r\nConnection: close\r\nContent-Type: text/plain;charset=utf8\r\n\r\n" #code " " reason, \
+    sizeof("HTTP/1.1 " #code " " reason "\r\nConnection: close\r\nContent-Type: text/plain;charset=utf8\r\n\r\n" #code " " reason) - 1 }
+
+static const struct {
+  uint16_t code;
+  const char * response;
+  size_t length;
+} prerenderedErrors[] = {
+  HTTPS_ERROR_RESPONSE(400, "Bad Request"),
+  HTTPS_ERROR_RESPONSE(404, "Not Found"),
+  HTTPS_ERROR_RESPONSE(408, "Request Timeout"),
+  HTTPS_ERROR_RESPONSE(413, "Payload Too Large"),
+  HTTPS_ERROR_RESPONSE(431, "Request Header Fields Too Large"),
+  HTTPS_ERROR_RESPONSE(500, "Internal Server Error"),
+  HTTPS_ERROR_RESPONSE(503, "Service Unavailable"),
+};
+
+/**
+ * Sends an error response with a single write and closes the connection.
+ *
+ * The response for common status codes is taken from a precomputed table. The reason is only used for
+ * other codes.
+ */
+void HTTPConnection::raiseError(uint16_t code, std::string const &reason) {
   _connectionState = STATE_ERROR;
-  std::string sCode = intToString(code);
-
-  char headers[] = "\r\nConnection: close\r\nContent-Type: text/plain;charset=utf8\r\n\r\n";
-  writeBuffer((byte*)"HTTP/1.1 ", 9);
-  writeBuffer((byte*)sCode.c_str(), sCode.length());
-  writeBuffer((byte*)" ", 1);
-  writeBuffer((byte*)(reason.c_str()), reason.length());
-  writeBuffer((byte*)headers, strlen(headers));
-  writeBuffer((byte*)sCode.c_str(), sCode.length());
-  writeBuffer((byte*)" ", 1);
-  writeBuffer((byte*)(reason.c_str()), reason.length());
+
+  bool sent = false;
+  for (size_t i = 0; i < sizeof(prerenderedErrors) / sizeof(prerenderedErrors[0]); i++) {
+    if (prerenderedErrors[i].code == code) {
+      writeBuffer((byte*)prerenderedErrors[i].response, prerenderedErrors[i].length);
+      sent = true;
+      break;
+    }
+  }
+
+  if (!sent) {
+    std::string sCode = intToString(code);
+    std::string response = "HTTP/1.1 " + sCode + " " + reason +
+      "\r\nConnection: close\r\nContent-Type: text/plain;charset=utf8\r\n\r\n" + sCode + " " + reason;
+    writeBuffer((byte*)response.data(), response.length());
+  }
+
   closeConnection();
 }
 
 void HTTPConnection::readLine(int lengthLimit) {
-  while(_bufferProcessed < _bufferUnusedIdx) {
-    char newChar = _receiveBuffer[_bufferProcessed];
-
-    if ( newChar == '\r') {
-      // Look ahead for \n (if not possible, wait for next round
-      if (_bufferProcessed+1 < _bufferUnusedIdx) {
-        if (_receiveBuffer[_bufferProcessed+1] == '\n') {
-          _bufferProcessed += 2;
-          _parserLine.parsingFinished = true;
-          return;
-        } else {
-          // Line has not been terminated by \r\n
-          HTTPS_LOGW("Line without \\r\\n (got only \\r). FID=%d", _socket);
-          raiseError(400, "Bad Request");
-          return;
-        }
+  while(_bufferLength > 0) {
+    // Copy everything up to the next \r at once
+    char * data;
+    size_t spanLength = getBufferDataSpan(data);
+    char * lineEnd = (char*)memchr(data, '\r', spanLength);
+    size_t textLength = (lineEnd == NULL ? spanLength : lineEnd - data);
+
+    if (textLength > 0) {
+      appendToLine(data, textLength);
+      consumeBuffer(textLength);
+    } else if (_bufferLength > 1) {
+      // Look ahead for \n
+      if (getBufferByte(1) == '\n') {
+        consumeBuffer(2);
+        _parserLine.parsingFinished = true;
+        return;
+      } else {
+        // Line has not been terminated by \r\n
+        HTTPS_LOGW("Line without \\r\\n (got only \\r). FID=%d", _socket);
+        raiseError(400, "Bad Request");
+        return;
       }
     } else {
-      _parserLine.text += newChar;
-      _bufferProcessed += 1;
+      // The \n has not been received yet, wait for the next round
+      return;
     }
 
     // Check that the max request string size is not exceeded
-    if (_parserLine.text.length() > lengthLimit) {
+    if (_parserLine.length > lengthLimit) {
       HTTPS_LOGW("Header length exceeded. FID=%d", _socket);
       raiseError(431, "Request Header Fields Too Large");
       return;
@@ -318,6 +803,50 @@ void HTTPConnection::readLine(int lengthLimit) {
   }
 }
 
+/**
+ * Appends data to the line that is currently parsed. The line is collected in the request arena, if
+ * there is enough space left, and on the heap otherwise.
+ */
+void HTTPConnection::appendToLine(const char * data, size_t length) {
+  if (!_parserLine.overflow) {
+    char * line = _requestArena + _requestArenaUsed;
+    if (_requestArenaUsed + _parserLine.length + length <= HTTPS_REQUEST_ARENA_SIZE) {
+      memcpy(line + _parserLine.length, data, length);
+      _parserLine.length += length;
+      return;
+    }
+    // Move what we have so far to the heap
+    _parserLine.overflowText.assign(line, _parserLine.length);
+    _parserLine.overflow = true;
+  }
+  _parserLine.overflowText.append(data, length);
+  _parserLine.length += length;
+}
+
+/**
+ * Returns the line that has been parsed by readLine() (without the \r\n)
+ */
+StringView HTTPConnection::getLine() {
+  if (_parserLine.overflow) {
+    return StringView(_parserLine.overflowText);
+  }
+  return StringView(_requestArena + _requestArenaUsed, _parserLine.length);
+}
+
+/**
+ * Prepares the parser for the next line. If keepInArena is set, the current line stays in the request
+ * arena, so that views on it remain valid until the request has been handled.
+ */
+void HTTPConnection::finishLine(bool keepInArena) {
+  if (keepInArena && !_parserLine.overflow) {
+    _requestArenaUsed += _parserLine.length;
+  }
+  _parserLine.length = 0;
+  _parserLine.parsingFinished = false;
+  _parserLine.overflow = false;
+  _parserLine.overflowText.clear();
+}
+
 /**
  * Called by the request to signal that the client has closed the connection
  */
@@ -342,267 +871,653 @@ size_t HTTPConnection::getCacheSize() {
   return (_isKeepAlive ? HTTPS_KEEPALIVE_CACHESIZE : 0);
 }
 
+/**
+ * Returns a buffer of HTTPS_RESPONSE_BUFFER_SIZE bytes for the response, or NULL if the pool of the
+ * server is exhausted. Without a pool, the buffer is allocated on the heap.
+ */
+byte * HTTPConnection::acquireResponseBuffer() {
+  if (_responseBuffers == NULL) {
+    return new byte[HTTPS_RESPONSE_BUFFER_SIZE];
+  }
+  return _responseBuffers->acquire();
+}
+
+/**
+ * Returns a buffer that has been obtained from acquireResponseBuffer()
+ */
+void HTTPConnection::releaseResponseBuffer(byte * buffer) {
+  if (_responseBuffers == NULL) {
+    delete[] buffer;
+  } else {
+    _responseBuffers->release(buffer);
+  }
+}
+
+/**
+ * Returns true if the response may be sent with Transfer-Encoding: chunked, which is the case for
+ * keep-alive connections of HTTP/1.1 clients.
+ */
+bool HTTPConnection::canUseChunkedEncoding() {
+  return _isKeepAlive && _isHTTP11;
+}
+
 void HTTPConnection::loop() {
-  // First, update the buffer
-  // newByteCount will contain the number of new bytes that have to be processed
-  updateBuffer();
+  // Remember where we started, so we can tell afterwards whether this call made any progress
+  int prevConnectionState = _connectionState;
+  unsigned long prevBufferTransferred = _bufferTransferred;
+
+  // First, update the buffer (unless we are still waiting for the handshake to finish or for a deferred
+  // response, which does not process input)
+  if (_connectionState != STATE_HANDSHAKE && _connectionState != STATE_DEFERRED) {
+    updateBuffer();
+  }
+
+  // Send what is left in the output queue, if the socket has become writable
+  flushOutput();
 
   if (_clientState == CSTATE_CLOSED) {
     HTTPS_LOGI("Client closed (FID=%d, cstate=%d)", _socket, _clientState);
   }
 
-  if (_clientState == CSTATE_CLOSED && _bufferProcessed == _bufferUnusedIdx && _connectionState < STATE_HEADERS_FINISHED) {
+  if (_clientState == CSTATE_CLOSED && _bufferLength == 0 && _connectionState < STATE_HEADERS_FINISHED && _outputQueue.empty()) {
     closeConnection();
   }
 
   if (!isClosed() && isTimeoutExceeded()) {
     HTTPS_LOGI("Connection timeout. FID=%d", _socket);
-    closeConnection();
+    if (_connectionState == STATE_DEFERRED) {
+      // The response has not been completed in time. If it has been completed just now, it is sent below
+      if (_deferred->cancel()) {
+        HTTPS_LOGW("Deferred response has not been completed in time. FID=%d", _socket);
+        raiseError(503, "Service Unavailable");
+      }
+#if HTTPS_COROUTINES
+    } else if (_connectionState == STATE_COROUTINE && !_coroutine->res.isHeaderWritten()) {
+      HTTPS_LOGW("Coroutine handler has not finished in time. FID=%d", _socket);
+      raiseError(503, "Service Unavailable");
+#endif
+    } else if (_connectionState == STATE_WEBSOCKET) {
+      // The client does not read the messages that are sent to it. The handler learns about it like
+      // about any other client that is gone
+      HTTPS_LOGW("Timeout while sending data, FID=%d", _socket);
+      signalWriteError();
+    } else {
+      if (_connectionState == STATE_HANDSHAKE) {
+        // Nothing to shut down gracefully, the session has never been established
+        _connectionState = STATE_ERROR;
+      }
+      closeConnection();
+    }
   }
 
   if (!isError()) {
-    // State machine (Reading request, reading headers, ...)
-    switch(_connectionState) {
-    case STATE_INITIAL: // Read request line
-      readLine(HTTPS_REQUEST_MAX_REQUEST_LENGTH);
-      if (_parserLine.parsingFinished && !isClosed()) {
-        // Find the method
-        size_t spaceAfterMethodIdx = _parserLine.text.find(' ');
-        if (spaceAfterMethodIdx == std::string::npos) {
-          HTTPS_LOGW("Missing space after method");
-          raiseError(400, "Bad Request");
+    // Run the state machine until the connection has to wait for the client, so that a request that
+    // has been received completely is answered in a single call. Requests that the client has sent
+    // without waiting for the responses (pipelining) are answered as well, and their responses are
+    // coalesced into as few writes as possible. The budget keeps one busy connection from starving
+    // the others
+    uint16_t firstRequest = _requestCount;
+    unsigned long firstTransferred = _bufferTransferred;
+    for (uint16_t step = 1; ; step++) {
+      if (_outputBlocked && _connectionState == STATE_HEADERS_FINISHED) {
+        // The client does not read the previous responses, so the next request has to wait
+        break;
+      }
+      int state = _connectionState;
+      unsigned long bufferTransferred = _bufferTransferred;
+      processState();
+
+      if (isClosed() || isError() || step >= HTTPS_CONNECTION_STEP_BUDGET ||
+          _bufferTransferred - firstTransferred >= HTTPS_CONNECTION_BYTE_BUDGET ||
+          (uint16_t)(_requestCount - firstRequest) >= HTTPS_PIPELINE_MAX_REQUESTS) {
+        break;
+      }
+      if (_connectionState == state && _bufferTransferred == bufferTransferred) {
+        // The state machine needs more input. Continue only if the client has sent it already. The
+        // handshake and the TLS shutdown read from the socket on their own, a deferred response does
+        // not need any input
+        if (_connectionState == STATE_HANDSHAKE || _connectionState == STATE_CLOSING ||
+            _connectionState == STATE_DEFERRED || updateBuffer() <= 0) {
           break;
         }
-        _httpMethod = _parserLine.text.substr(0, spaceAfterMethodIdx);
+      }
+    }
+  }
+  flushOutput();
 
-        // Find the resource string:
-        size_t spaceAfterResourceIdx = _parserLine.text.find(' ', spaceAfterMethodIdx + 1);
-        if (spaceAfterResourceIdx == std::string::npos) {
-          HTTPS_LOGW("Missing space after resource");
-          raiseError(400, "Bad Request");
-          break;
-        }
-        _httpResource = _parserLine.text.substr(spaceAfterMethodIdx + 1, spaceAfterResourceIdx - _httpMethod.length() - 1);
+  // If nothing happened, there is no need to call loop() again before new data arrives
+  _waitingForInput = (
+    prevConnectionState == _connectionState &&
+    prevBufferTransferred == _bufferTransferred
+  );
+}
 
-        _parserLine.parsingFinished = false;
-        _parserLine.text = "";
-        HTTPS_LOGI("Request: %s %s (FID=%d)", _httpMethod.c_str(), _httpResource.c_str(), _socket);
-        _connectionState = STATE_REQUEST_FINISHED;
+/**
+ * Runs one step of the state machine (reading the request, reading headers, ...)
+ *
+ * A step that neither changes the state nor consumes or receives data means that the connection has
+ * to wait for more input.
+ */
+void HTTPConnection::processState() {
+  // State machine (Reading request, reading headers, ...)
+  switch(_connectionState) {
+  case STATE_HANDSHAKE: // Continue the handshake as far as possible without blocking
+    continueHandshake();
+    break;
+  case STATE_INITIAL: // Read request line
+    readLine(HTTPS_REQUEST_MAX_REQUEST_LENGTH);
+    if (_parserLine.parsingFinished && !isClosed()) {
+      StringView line = getLine();
+
+      // Find the method
+      size_t spaceAfterMethodIdx = line.find(' ');
+      if (spaceAfterMethodIdx == StringView::npos) {
+        HTTPS_LOGW("Missing space after method");
+        raiseError(400, "Bad Request");
+        break;
+      }
+      // assign() reuses the memory of the previous request
+      _httpMethod.assign(line.data(), spaceAfterMethodIdx);
+
+      // Find the resource string:
+      size_t spaceAfterResourceIdx = line.find(' ', spaceAfterMethodIdx + 1);
+      if (spaceAfterResourceIdx == StringView::npos) {
+        HTTPS_LOGW("Missing space after resource");
+        raiseError(400, "Bad Request");
+        break;
       }
+      _httpResource.assign(line.data() + spaceAfterMethodIdx + 1, spaceAfterResourceIdx - spaceAfterMethodIdx - 1);
 
-      break;
-    case STATE_REQUEST_FINISHED: // Read headers
+      // The rest is the protocol version
+      _isHTTP11 = line.substr(spaceAfterResourceIdx + 1).equals("HTTP/1.1");
 
-      while (_bufferProcessed < _bufferUnusedIdx && !isClosed()) {
-        readLine(HTTPS_REQUEST_MAX_HEADER_LENGTH);
-        if (_parserLine.parsingFinished && _connectionState != STATE_ERROR) {
+      finishLine(false);
+      HTTPS_LOGI("Request: %s %s (FID=%d)", _httpMethod.c_str(), _httpResource.c_str(), _socket);
+      _connectionState = STATE_REQUEST_FINISHED;
+    }
 
-          if (_parserLine.text.empty()) {
-            HTTPS_LOGD("Headers finished, FID=%d", _socket);
-            _connectionState = STATE_HEADERS_FINISHED;
+    break;
+  case STATE_REQUEST_FINISHED: // Read headers
 
-            // Break, so that the rest of the body does not get flushed through
-            _parserLine.parsingFinished = false;
-            _parserLine.text = "";
-            break;
-          } else {
-            int idxColon = _parserLine.text.find(':');
-            if ( (idxColon != std::string::npos) && (_parserLine.text[idxColon+1]==' ') ) {
-              _httpHeaders->set(new HTTPHeader(
-                  _parserLine.text.substr(0, idxColon),
-                  _parserLine.text.substr(idxColon+2)
-              ));
-              HTTPS_LOGD("Header: %s = %s (FID=%d)", _parserLine.text.substr(0, idxColon).c_str(), _parserLine.text.substr(idxColon+2).c_str(), _socket);
-            } else {
-              HTTPS_LOGW("Malformed request header: %s", _parserLine.text.c_str());
-              raiseError(400, "Bad Request");
-              break;
-            }
-          }
+    while (_bufferLength > 0 && !isClosed()) {
+      readLine(HTTPS_REQUEST_MAX_HEADER_LENGTH);
+      if (_parserLine.parsingFinished && _connectionState != STATE_ERROR) {
+        StringView line = getLine();
 
-          _parserLine.parsingFinished = false;
-          _parserLine.text = "";
-        }
-      }
+        if (line.empty()) {
+          HTTPS_LOGD("Headers finished, FID=%d", _socket);
+          _connectionState = STATE_HEADERS_FINISHED;
 
-      break;
-    case STATE_HEADERS_FINISHED: // Handle body
-      {
-        HTTPS_LOGD("Resolving resource...");
-        ResolvedResource resolvedResource;
-
-        // Check which kind of node we need (Websocket or regular)
-        bool websocketRequested = checkWebsocket();
-
-        _resResolver->resolveNode(_httpMethod, _httpResource, resolvedResource, websocketRequested ? WEBSOCKET : HANDLER_CALLBACK);
-
-        // Is there any match (may be the defaultNode, if it is configured)
-        if (resolvedResource.didMatch()) {
-          // Check for client's request to keep-alive if we have a handler function.
-          if (resolvedResource.getMatchingNode()->_nodeType == HANDLER_CALLBACK) {
-            // Did the client set connection:keep-alive?
-            HTTPHeader * connectionHeader = _httpHeaders->get("Connection");
-            std::string connectionHeaderValue = "";
-            if (connectionHeader != NULL) {
-              connectionHeaderValue += connectionHeader->_value;
-              std::transform(
-                connectionHeaderValue.begin(),
-                connectionHeaderValue.end(),
-                connectionHeaderValue.begin(),
-                [](unsigned char c){ return ::tolower(c); }
-              );
-            }
-            if (std::string("keep-alive").compare(connectionHeaderValue)==0) {
-              HTTPS_LOGD("Keep-Alive activated. FID=%d", _socket);
-              _isKeepAlive = true;
+          // Break, so that the rest of the body does not get flushed through
+          finishLine(false);
+          break;
+        } else {
+          size_t idxColon = line.find(':');
+          if ( (idxColon != StringView::npos) && (idxColon + 1 < line.length()) && (line[idxColon+1]==' ') ) {
+            StringView name = line.substr(0, idxColon);
+            StringView value = line.substr(idxColon+2);
+            HTTPS_LOGD("Header: %.*s = %.*s (FID=%d)", (int)name.length(), name.data(), (int)value.length(), value.data(), _socket);
+            if (_parserLine.overflow) {
+              // The line could not be stored in the arena
+              _httpHeaders->set(new HTTPHeader(name.toString(), value.toString()));
+              finishLine(false);
             } else {
-              HTTPS_LOGD("Keep-Alive disabled. FID=%d", _socket);
-              _isKeepAlive = false;
+              // Keep the line in the arena and only store references to it
+              _httpHeaders->setView(name, value);
+              finishLine(true);
             }
           } else {
-            _isKeepAlive = false;
-          }
-
-          // Create request context
-          HTTPRequest req  = HTTPRequest(
-            this,
-            _httpHeaders,
-            resolvedResource.getMatchingNode(),
-            _httpMethod,
-            resolvedResource.getParams(),
-            _httpResource
-          );
-          HTTPResponse res = HTTPResponse(this);
-
-          // Add default headers to the response
-          auto allDefaultHeaders = _defaultHeaders->getAll();
-          for(std::vector<HTTPHeader*>::iterator header = allDefaultHeaders->begin(); header != allDefaultHeaders->end(); ++header) {
-            res.setHeader((*header)->_name, (*header)->_value);
-          }
-
-          // Find the request handler callback
-          HTTPSCallbackFunction * resourceCallback;
-          if (websocketRequested) {
-            // For the websocket, we use the handshake callback defined below
-            resourceCallback = &handleWebsocketHandshake;
-          } else {
-            // For resource nodes, we use the callback defined by the node itself
-            resourceCallback = ((ResourceNode*)resolvedResource.getMatchingNode())->_callback;
-          }
-
-          // Get the current middleware chain
-          auto vecMw = _resResolver->getMiddleware();
-
-          // Anchor of the chain is the actual resource. The call to the handler is bound here
-          std::function<void()> next = std::function<void()>(std::bind(resourceCallback, &req, &res));
-
-          // Go back in the middleware chain and glue everything together
-          auto itMw = vecMw.rbegin();
-          while(itMw != vecMw.rend()) {
-            next = std::function<void()>(std::bind((*itMw), &req, &res, next));
-            itMw++;
+            HTTPS_LOGW("Malformed request header: %.*s", (int)line.length(), line.data());
+            raiseError(400, "Bad Request");
+            break;
           }
+        }
+      }
+    }
 
-          // We insert the internal validation middleware at the start of the chain:
-          next = std::function<void()>(std::bind(&validationMiddleware, &req, &res, next));
+    break;
+  case STATE_HEADERS_FINISHED: // Handle body
+    {
+      HTTPS_LOGD("Resolving resource...");
+      ResolvedResource resolvedResource;
+
+      // Check which kind of node we need (Websocket or regular)
+      bool websocketRequested = checkWebsocket();
+
+      _resResolver->resolveNode(_httpMethod, _httpResource, resolvedResource, websocketRequested ? WEBSOCKET : HANDLER_CALLBACK);
+
+      // Is there any match (may be the defaultNode, if it is configured)
+      if (resolvedResource.didMatch()) {
+        _requestCount++;
+        // Keep-alive is only possible if we have a handler function
+        _isKeepAlive = (resolvedResource.getMatchingNode()->_nodeType == HANDLER_CALLBACK && checkKeepAlive());
+        HTTPS_LOGD("Keep-Alive %s. FID=%d", _isKeepAlive ? "activated" : "disabled", _socket);
+
+        // If there is more data than the body of this request, the client has already sent the
+        // next request
+        StringView contentLength = _httpHeaders->getView(HEADER_ID_CONTENT_LENGTH);
+        _pipelining = _isKeepAlive &&
+          _bufferLength + pendingByteCount() > parseUInt(contentLength.data(), contentLength.length());
+
+#if HTTPS_COROUTINES
+        if (!websocketRequested && ((ResourceNode*)resolvedResource.getMatchingNode())->_coroutine != NULL) {
+          // Request and response of a coroutine have to outlive this call
+          startCoroutine(resolvedResource);
+          break;
+        }
+#endif
+
+        // Create request context
+        HTTPRequest req  = HTTPRequest(
+          this,
+          _httpHeaders,
+          resolvedResource.getMatchingNode(),
+          _httpMethod,
+          resolvedResource.getParams(),
+          _httpResource
+        );
+        // The response is constructed in the connection, in case the handler continues it later
+        HTTPResponse * res = new (_responseStorage) HTTPResponse(this);
+        prepareResponse(*res);
+
+        // Find the request handler callback
+        HTTPSCallbackFunction * resourceCallback;
+        if (websocketRequested) {
+          // For the websocket, we use the handshake callback defined below
+          resourceCallback = &handleWebsocketHandshake;
+        } else {
+          // For resource nodes, we use the callback defined by the node itself
+          resourceCallback = ((ResourceNode*)resolvedResource.getMatchingNode())->_callback;
+        }
 
-          // Call the whole chain
-          next();
+        // The call to the handler is bound here and passed through the middleware chain
+        callHandler(&req, res, std::function<void()>(std::bind(resourceCallback, &req, res)));
 
-          // The callback-function should have read all of the request body.
-          // However, if it does not, we need to clear the request body now,
-          // because otherwise it would be parsed in the next request.
-          if (!req.requestComplete()) {
-            HTTPS_LOGW("Callback function did not parse full request body");
-            req.discardRequestBody();
-          }
+        // The callback-function should have read all of the request body.
+        // However, if it does not, we need to clear the request body now,
+        // because otherwise it would be parsed in the next request.
+        // After a websocket handshake, anything that follows is already the first frame.
+        if (!websocketRequested && !req.requestComplete()) {
+          HTTPS_LOGW("Callback function did not parse full request body");
+          req.discardRequestBody();
+        }
 
-          // Finally, after the handshake is done, we create the WebsocketHandler and change the internal state.
-          if(websocketRequested) {
-            _wsHandler = ((WebsocketNode*)resolvedResource.getMatchingNode())->newHandler();
-            _wsHandler->initialize(this);  // make websocket with this connection 
-            _connectionState = STATE_WEBSOCKET;
-          } else {
-            // Handling the request is done
-            HTTPS_LOGD("Handler function done, request complete");
-
-            // Now we need to check if we can use keep-alive to reuse the SSL connection
-            // However, if the client did not set content-size or defined connection: close,
-            // we have no chance to do so.
-            if (!_isKeepAlive) {
-              // No KeepAlive -> We are done. Transition to next state.
-              if (!isClosed()) {
-                _connectionState = STATE_BODY_FINISHED;
-              }
-            } else {
-              if (res.isResponseBuffered()) {
-                // If the response could be buffered:
-                res.setHeader("Connection", "keep-alive");
-                res.finalize();
-                if (_clientState != CSTATE_CLOSED) {
-                  // Refresh the timeout for the new request
-                  refreshTimeout();
-                  // Reset headers for the new connection
-                  _httpHeaders->clearAll();
-                  // Go back to initial state
-                  _connectionState = STATE_INITIAL;
-                }
-              }
-              // The response could not be buffered or the client has closed:
-              if (!isClosed() && _connectionState!=STATE_INITIAL) {
-                _connectionState = STATE_BODY_FINISHED;
-              }
-            }
+        // Finally, after the handshake is done, we create the WebsocketHandler and change the internal state.
+        if(websocketRequested) {
+          _wsHandler = ((WebsocketNode*)resolvedResource.getMatchingNode())->newHandler();
+          _wsHandler->initialize(this);  // make websocket with this connection 
+          _connectionState = STATE_WEBSOCKET;
+        } else if (_deferred != NULL) {
+          // The response is completed by another task. The request headers are kept until then
+          HTTPS_LOGD("Response deferred. FID=%d", _socket);
+          refreshTimeout();
+          _connectionState = STATE_DEFERRED;
+        } else if (res->hasWritableCallback() && !isClosed() && _connectionState != STATE_CLOSING) {
+          // The handler continues the response whenever the client can take more data. Like a waiting
+          // coroutine, it must not hold on to a buffer of the pool meanwhile
+          HTTPS_LOGD("Handler continues the response. FID=%d", _socket);
+          if (_responseBuffers != NULL) {
+            res->detachResponseBuffer();
           }
+          _response = res;
+          _connectionState = STATE_STREAMING;
+        } else {
+          // Handling the request is done
+          HTTPS_LOGD("Handler function done, request complete");
+          finishResponse(*res);
+        }
+        if (_response == NULL) {
+          res->~HTTPResponse();
+        }
+        _pipelining = false;
+      } else {
+        // No match (no default route configured, nothing does match)
+        HTTPS_LOGW("Could not find a matching resource");
+        const std::string &defaultResponse = _resResolver->getDefaultResponse();
+        if (!defaultResponse.empty()) {
+          writeBuffer((byte*)defaultResponse.data(), defaultResponse.length());
+          _connectionState = STATE_BODY_FINISHED;
         } else {
-          // No match (no default route configured, nothing does match)
-          HTTPS_LOGW("Could not find a matching resource");
           raiseError(404, "Not Found");
         }
-
       }
-      break;
-    case STATE_BODY_FINISHED: // Request is complete
-      closeConnection();
-      break;
-    case STATE_CLOSING: // As long as we are in closing state, we call closeConnection() again and wait for it to finish or timeout
+
+    }
+    break;
+  case STATE_DEFERRED: // Wait for another task to complete the response
+    if (_deferred->isCompleted()) {
+      sendDeferredResponse();
+    }
+    break;
+#if HTTPS_COROUTINES
+  case STATE_COROUTINE: // Resume the coroutine handler once what it awaits is ready
+    if (_coroutine->coroutine.canResume()) {
+      refreshTimeout();
+      _coroutineRunning = true;
+      _coroutine->coroutine.resume();
+      _coroutineRunning = false;
+      finishCoroutine();
+    }
+    break;
+#endif
+  case STATE_STREAMING: // Let the handler continue its response while the client can take more data
+    continueResponse();
+    break;
+  case STATE_BODY_FINISHED: // Request is complete
+    // The connection is closed as soon as the rest of the response has been sent
+    if (flushOutput()) {
       closeConnection();
-      break;
-    case STATE_WEBSOCKET: // Do handling of the websocket
+    }
+    break;
+  case STATE_CLOSING: // As long as we are in closing state, we call closeConnection() again and wait for it to finish or timeout
+    closeConnection();
+    break;
+  case STATE_WEBSOCKET: // Do handling of the websocket
+    if (_outputQueue.empty()) {
       refreshTimeout();  // don't timeout websocket connection
-      if(pendingBufferSize() > 0) {
-        HTTPS_LOGD("Calling WS handler, FID=%d", _socket);
-        _wsHandler->loop();
-      }
+    }
+    if(pendingBufferSize() > 0) {
+      HTTPS_LOGD("Calling WS handler, FID=%d", _socket);
+      _wsHandler->loop();
+    }
 
-      // If the client closed the connection unexpectedly
-      if (_clientState == CSTATE_CLOSED) {
-        HTTPS_LOGI("WS lost client, calling onClose, FID=%d", _socket);
-        _wsHandler->onClose();
-      }
+    // Tell the handler if a message that it could not send before fits into the output queue now
+    _wsHandler->checkWritable();
+    // Send what other tasks have queued in the meantime
+    _wsHandler->sendQueuedMessages();
+
+    // If the client closed the connection unexpectedly
+    if (_clientState == CSTATE_CLOSED) {
+      HTTPS_LOGI("WS lost client, calling onClose, FID=%d", _socket);
+      _wsHandler->onClose();
+    }
+
+    // If the handler has terminated the connection, clean up and close the socket too
+    if (_wsHandler->closed() || _clientState == CSTATE_CLOSED) {
+      HTTPS_LOGI("WS closed, freeing Handler, FID=%d", _socket);
+      delete _wsHandler;
+      _wsHandler = nullptr;
+      _connectionState = STATE_CLOSING;
+    }
+    break;
+  default:;
+  }
+}
+
+/**
+ * Sets the headers that every response of this connection starts with
+ */
+void HTTPConnection::prepareResponse(HTTPResponse &res) {
+  // Add default headers to the response. They are copied when the header is written
+  res.setDefaultHeaders(_defaultHeaders);
+  // HTTP/1.1 clients expect the connection to stay open unless we tell them otherwise
+  if (!_isKeepAlive && _isHTTP11) {
+    res.setHeader("Connection", "close");
+  }
+}
 
-      // If the handler has terminated the connection, clean up and close the socket too
-      if (_wsHandler->closed() || _clientState == CSTATE_CLOSED) {
-        HTTPS_LOGI("WS closed, freeing Handler, FID=%d", _socket);
-        delete _wsHandler;
-        _wsHandler = nullptr;
-        _connectionState = STATE_CLOSING;
+/**
+ * Calls the handler through the middleware chain
+ */
+void HTTPConnection::callHandler(HTTPRequest * req, HTTPResponse * res, std::function<void()> handler) {
+  // Get the current middleware chain
+  auto vecMw = _resResolver->getMiddleware();
+
+  // Anchor of the chain is the actual resource
+  std::function<void()> next = handler;
+
+  // Go back in the middleware chain and glue everything together
+  auto itMw = vecMw.rbegin();
+  while(itMw != vecMw.rend()) {
+    next = std::function<void()>(std::bind((*itMw), req, res, next));
+    itMw++;
+  }
+
+  // We insert the internal validation middleware at the start of the chain:
+  next = std::function<void()>(std::bind(&validationMiddleware, req, res, next));
+
+  // Call the whole chain
+  next();
+}
+
+/**
+ * Finalizes the response to the current request and prepares the connection for the next request, if
+ * the connection can be kept alive.
+ */
+void HTTPConnection::finishResponse(HTTPResponse &res) {
+  // Now we need to check if we can use keep-alive to reuse the SSL connection
+  // However, if the client did not set content-size or defined connection: close,
+  // we have no chance to do so.
+  if (!_isKeepAlive) {
+    // No KeepAlive -> We are done. Transition to next state.
+    res.finalize();
+    if (!isClosed()) {
+      _connectionState = STATE_BODY_FINISHED;
+    }
+  } else {
+    if (res.isKeepAlivePossible()) {
+      // If the response could be buffered or is sent in chunks:
+      res.setHeader("Connection", "keep-alive");
+      res.finalize();
+      if (_clientState != CSTATE_CLOSED) {
+        // Refresh the timeout for the new request
+        refreshTimeout();
+        // Reset headers for the new connection
+        _httpHeaders->clearAll();
+        _requestArenaUsed = 0;
+        // Go back to initial state
+        _connectionState = STATE_INITIAL;
       }
-      break;
-    default:;
+    } else {
+      res.finalize();
+    }
+    // The response has been streamed without a length or the client has closed:
+    if (!isClosed() && _connectionState!=STATE_INITIAL) {
+      _connectionState = STATE_BODY_FINISHED;
     }
   }
+}
 
+/**
+ * Lets the handler continue its response in STATE_STREAMING, if the output queue has space. Once the
+ * handler is done, the response is finished like after any other handler.
+ */
+void HTTPConnection::continueResponse() {
+  if (_outputError) {
+    // The client is gone, and so is the rest of the response
+    closeConnection();
+    return;
+  }
+  if (getOutputSpace() == 0) {
+    return;
+  }
+  // The callback may close the connection, which must not destroy the response while it is in use
+  HTTPResponse * res = _response;
+  _response = NULL;
+  bool continued = res->continueWriting();
+  if (isClosed() || _connectionState == STATE_CLOSING) {
+    continued = false;
+  } else if (!continued) {
+    HTTPS_LOGD("Handler has finished the response, request complete");
+    finishResponse(*res);
+  }
+  if (continued) {
+    _response = res;
+  } else {
+    res->~HTTPResponse();
+  }
+}
+
+/**
+ * Destroys the response that a handler continues in STATE_STREAMING, if there is one
+ */
+void HTTPConnection::releaseResponse() {
+  if (_response != NULL) {
+    _response->~HTTPResponse();
+    _response = NULL;
+  }
 }
 
+/**
+ * Creates the handle for a response that is completed by another task. Called by HTTPResponse::defer().
+ */
+DeferredResponse * HTTPConnection::deferResponse(unsigned long timeoutMs) {
+  if (_deferred != NULL || _connectionState != STATE_HEADERS_FINISHED) {
+    return NULL;
+  }
+  _deferred = new DeferredResponse(openWakeupSocket());
+  _deferredTimeout = timeoutMs;
+  return _deferred;
+}
+
+/**
+ * Returns the wakeup socket for a Completion, after making sure that it is open.
+ *
+ * The socket is only created when it is used for the first time. As this runs in the task that
+ * processes the connection, that task watches it from its next pass on.
+ */
+WakeupSocket * HTTPConnection::openWakeupSocket() {
+  if (_wakeup != NULL && !_wakeup->open()) {
+    HTTPS_LOGW("Completions from other tasks are only detected on timeout");
+  }
+  return _wakeup;
+}
+
+/**
+ * Sends the response that has been completed by another task, like the handler would have done
+ */
+void HTTPConnection::sendDeferredResponse() {
+  HTTPS_LOGD("Sending deferred response. FID=%d", _socket);
+  refreshTimeout();
+  HTTPResponse res = HTTPResponse(this);
+  prepareResponse(res);
+  _deferred->writeTo(&res);
+  releaseDeferredResponse();
+  finishResponse(res);
+}
+
+/**
+ * Drops the connection's reference to the deferred response. A response that has not been completed
+ * yet is cancelled.
+ */
+void HTTPConnection::releaseDeferredResponse() {
+  if (_deferred != NULL) {
+    _deferred->cancel();
+    _deferred->release();
+    _deferred = NULL;
+  }
+}
+
+#if HTTPS_COROUTINES
+/**
+ * Allocates memory for a coroutine frame from the arena. Returns NULL if it does not fit.
+ *
+ * The memory is not freed individually, the arena is reset when the request has been handled.
+ */
+void * HTTPConnection::allocateFrame(size_t size) {
+  const size_t alignment = alignof(std::max_align_t);
+  size_t offset = (_coroutineArenaUsed + alignment - 1) & ~(alignment - 1);
+  if (offset + size > HTTPS_COROUTINE_ARENA_SIZE) {
+    HTTPS_LOGE("Coroutine frame of %u bytes does not fit into the arena (%u of %u bytes used)",
+      size, offset, HTTPS_COROUTINE_ARENA_SIZE);
+    return NULL;
+  }
+  _coroutineArenaUsed = offset + size;
+  return _coroutineArena + offset;
+}
+
+/**
+ * Creates a Completion that a coroutine handler of this connection can await
+ */
+Completion * HTTPConnection::createCompletion() {
+  return new Completion(openWakeupSocket());
+}
+
+/**
+ * Calls a coroutine handler through the middleware chain. It runs until it awaits something that is
+ * not ready or returns.
+ */
+void HTTPConnection::startCoroutine(ResolvedResource &resolvedResource) {
+  static_assert(sizeof(CoroutineContext) < HTTPS_COROUTINE_ARENA_SIZE, "HTTPS_COROUTINE_ARENA_SIZE is too small");
+  _coroutineArenaUsed = 0;
+  _coroutine = new (allocateFrame(sizeof(CoroutineContext))) CoroutineContext(this, resolvedResource);
+  HTTPRequest * req = &_coroutine->req;
+  HTTPResponse * res = &_coroutine->res;
+  prepareResponse(*res);
+
+  const HTTPSCoroutineFunction * handler = ((ResourceNode*)resolvedResource.getMatchingNode())->_coroutine;
+  bool called = false;
+  _coroutineRunning = true;
+  callHandler(req, res, [this, handler, req, res, &called]() {
+    called = true;
+    _coroutine->coroutine = handler(req, res);
+  });
+  _coroutineRunning = false;
+
+  if (called && !_coroutine->coroutine.isValid() && !isClosed()) {
+    // The frame did not fit into the arena
+    raiseError(500, "Internal Server Error");
+  }
+  finishCoroutine();
+}
+
+/**
+ * Called whenever the coroutine handler has been suspended or has returned. Waits for it in
+ * STATE_COROUTINE, or finishes the response once it has returned.
+ */
+void HTTPConnection::finishCoroutine() {
+  if (_coroutine == NULL) {
+    return;
+  }
+  if (isClosed() || _connectionState == STATE_CLOSING) {
+    // The connection has been closed while the coroutine was running
+    releaseCoroutine();
+    return;
+  }
+  if (!_coroutine->coroutine.isDone()) {
+    // While the coroutine waits, the buffer of the response is taken from the heap, so that the other
+    // connections can still use the pool of the server to keep their clients alive
+    if (_responseBuffers != NULL) {
+      _coroutine->res.detachResponseBuffer();
+    }
+    _connectionState = STATE_COROUTINE;
+    return;
+  }
+
+  if (_coroutine->res.hasWritableCallback()) {
+    HTTPS_LOGE("Coroutine handlers cannot use onWritable(), they use awaitWritable() instead");
+  }
+  // Like for regular handlers, the rest of the body must not be parsed as the next request
+  if (!_coroutine->req.requestComplete()) {
+    HTTPS_LOGW("Coroutine handler did not parse full request body");
+    _coroutine->req.discardRequestBody();
+  }
+  HTTPS_LOGD("Coroutine handler done, request complete");
+  finishResponse(_coroutine->res);
+  releaseCoroutine();
+  _pipelining = false;
+}
+
+/**
+ * Destroys the coroutine (unless it is running right now), its request and response, and resets the
+ * arena
+ */
+void HTTPConnection::releaseCoroutine() {
+  if (_coroutine != NULL && !_coroutineRunning) {
+    _coroutine->~CoroutineContext();
+    _coroutine = NULL;
+    _coroutineArenaUsed = 0;
+  }
+}
+#endif
 
 bool HTTPConnection::checkWebsocket() {
   if(_httpMethod == "GET" &&
-     !_httpHeaders->getValue("Host").empty() &&
-      _httpHeaders->getValue("Upgrade") == "websocket" &&
-      _httpHeaders->getValue("Connection").find("Upgrade") != std::string::npos &&
-     !_httpHeaders->getValue("Sec-WebSocket-Key").empty() &&
-      _httpHeaders->getValue("Sec-WebSocket-Version") == "13") {
+     !_httpHeaders->getView(HEADER_ID_HOST).empty() &&
+      _httpHeaders->getView(HEADER_ID_UPGRADE).equals("websocket") &&
+      containsToken(_httpHeaders->getView(HEADER_ID_CONNECTION), "upgrade") &&
+     !_httpHeaders->getView(HEADER_ID_SEC_WEBSOCKET_KEY).empty() &&
+      _httpHeaders->getView(HEADER_ID_SEC_WEBSOCKET_VERSION).equals("13")) {
 
       HTTPS_LOGI("Upgrading to WS, FID=%d", _socket);
       return true;
@@ -610,6 +1525,23 @@ bool HTTPConnection::checkWebsocket() {
       return false;
 }
 
+/**
+ * Decides whether the connection is kept open after the current request. HTTP/1.1 connections are
+ * persistent unless the client sends "Connection: close", HTTP/1.0 clients have to ask for keep-alive.
+ * Requests with a chunked body are not supported on persistent connections, and the connection is
+ * closed after HTTPS_KEEPALIVE_MAX_REQUESTS requests.
+ */
+bool HTTPConnection::checkKeepAlive() {
+  StringView connection = _httpHeaders->getView(HEADER_ID_CONNECTION);
+  if (containsToken(connection, "close") || !_httpHeaders->getView(HEADER_ID_TRANSFER_ENCODING).empty()) {
+    return false;
+  }
+  if (HTTPS_KEEPALIVE_MAX_REQUESTS > 0 && _requestCount >= HTTPS_KEEPALIVE_MAX_REQUESTS) {
+    return false;
+  }
+  return _isHTTP11 || containsToken(connection, "keep-alive");
+}
+
 /**
  * Middleware function that handles the validation of parameters
  */
@@ -5,9 +5,12 @@
 #include <IPAddress.h>
 
 #include <string>
+#include <climits>
 #include <mbedtls/base64.h>
 #include <hwcrypto/sha.h>
 #include <functional>
+#include <cstddef>
+#include <new>
 
 // Required for sockets
 #include "lwip/netdb.h"
@@ -19,6 +22,7 @@
 
 #include "HTTPHeaders.hpp"
 #include "HTTPHeader.hpp"
+#include "StringView.hpp"
 
 #include "ResourceResolver.hpp"
 #include "ResolvedResource.hpp"
@@ -26,6 +30,10 @@
 #include "ResourceNode.hpp"
 #include "HTTPRequest.hpp"
 #include "HTTPResponse.hpp"
+#include "ResponseBufferPool.hpp"
+#include "DeferredResponse.hpp"
+#include "WakeupSocket.hpp"
+#include "HTTPCoroutine.hpp"
 
 #include "WebsocketHandler.hpp"
 #include "WebsocketNode.hpp"
@@ -40,7 +48,8 @@ public:
   HTTPConnection(ResourceResolver * resResolver);
   virtual ~HTTPConnection();
 
-  virtual int initialize(int serverSocketID, HTTPHeaders *defaultHeaders);
+  virtual int initialize(int serverSocketID, std::string const *defaultHeaders, ResponseBufferPool *responseBuffers = NULL);
+  virtual void reset();
   virtual void closeConnection();
   virtual bool isSecure();
   virtual IPAddress getClientIP();
@@ -49,15 +58,31 @@ public:
   bool isClosed();
   bool isError();
 
+  int getSocket();
+  bool needsProcessing();
+  unsigned long millisUntilTimeout();
+  void signalSocketReadable();
+  bool waitsForReadable();
+  virtual bool waitsForWritable();
+  void setWakeupSocket(WakeupSocket * wakeup);
+
 protected:
   friend class HTTPRequest;
   friend class HTTPResponse;
   friend class WebsocketInputStreambuf;
 
   virtual size_t writeBuffer(byte* buffer, size_t length);
+  virtual int writeSocket(byte* buffer, size_t length);
+  bool flushOutput();
+  void setNonBlocking(bool nonBlocking);
   virtual size_t readBytesToBuffer(byte* buffer, size_t length);
   virtual bool canReadData();
   virtual size_t pendingByteCount();
+  virtual void continueHandshake();
+
+  bool isTimeoutExceeded();
+  unsigned long getTimeout();
+  void refreshTimeout();
 
   // Timestamp of the last transmission action
   unsigned long _lastTransmissionTS;
@@ -65,9 +90,19 @@ protected:
   // Timestamp of when the shutdown was started
   unsigned long _shutdownTS;
 
+  // Set by the server if its readiness poll reported data on the socket, so that canReadData()
+  // does not need to poll the socket again
+  bool _socketReadable;
+
+  // True if the last call to loop() neither changed the state nor consumed or received data,
+  // meaning the connection has to wait for the socket to become readable
+  bool _waitingForInput;
+
   // Internal state machine of the connection:
   //
   // O --- > STATE_UNDEFINED -- initialize() --> STATE_INITIAL -- get / http/1.1 --> STATE_REQUEST_FINISHED --.
+  //           (TLS) |                     ^         |                                       |                 |
+  //                 `-> STATE_HANDSHAKE --´         |                                       |                 |
   //                     |                          |                                       |                 |
   //                     |                          |                                       |                 | Host: ...\r\n
   // STATE_ERROR <- on error-----------------------<---------------------------------------<                  | Foo: bar\r\n
@@ -78,18 +113,32 @@ protected:
   // STATE_CLOSING <---- STATE_WEBSOCKET <-.        |                                       |                 |
   //  ^                                    |        |                                       |                 |
   //  `---------- close() ---------- STATE_BODY_FINISHED <-- Body received or GET -- STATE_HEADERS_FINISHED <-´
+  //                                          ^                                                |
+  //                                          `---------------- completed --- STATE_DEFERRED <-´ defer()
+  //
+  // A keep-alive connection goes back to STATE_INITIAL instead of STATE_BODY_FINISHED after the response.
+  // A coroutine handler that has to wait is resumed from STATE_COROUTINE, which works like STATE_DEFERRED.
+  // A handler that continues its response with HTTPResponse::onWritable() does so from STATE_STREAMING.
   //
   enum {
     // The order is important, to be able to use state <= STATE_HEADERS_FINISHED etc.
 
     // The connection has not been established yet
     STATE_UNDEFINED,
+    // The TLS handshake is in progress (HTTPSConnection only)
+    STATE_HANDSHAKE,
     // The connection has just been created
     STATE_INITIAL,
     // The request line has been parsed
     STATE_REQUEST_FINISHED,
     // The headers have been parsed
     STATE_HEADERS_FINISHED,
+    // The handler has deferred the response and the connection waits for it to be completed
+    STATE_DEFERRED,
+    // A coroutine handler waits for something (only with HTTPS_COROUTINES)
+    STATE_COROUTINE,
+    // The handler has returned, but continues its response whenever the socket is writable
+    STATE_STREAMING,
     // The body has been parsed/the complete request has been processed (GET has body of length 0)
     STATE_BODY_FINISHED,
     // The connection is in websocket mode
@@ -109,28 +158,59 @@ protected:
   } _clientState;
 
 private:
-  void raiseError(uint16_t code, std::string reason);
+  void raiseError(uint16_t code, std::string const &reason);
   void readLine(int lengthLimit);
-
-  bool isTimeoutExceeded();
-  void refreshTimeout();
+  void appendToLine(const char * data, size_t length);
+  StringView getLine();
+  void finishLine(bool keepInArena);
 
   int updateBuffer();
+  int receiveData(byte* buffer, size_t length);
+  size_t getBufferDataSpan(char *&data);
+  size_t getBufferFreeSpan(char *&freeSpace);
+  char getBufferByte(size_t offset);
+  void consumeBuffer(size_t length);
   size_t pendingBufferSize();
 
   void signalClientClose();
   void signalRequestError();
   size_t readBuffer(byte* buffer, size_t length);
+  size_t getOutputSpace();
+  bool waitForWritable();
+  void signalWriteError();
   size_t getCacheSize();
+  bool canUseChunkedEncoding();
+  byte * acquireResponseBuffer();
+  void releaseResponseBuffer(byte * buffer);
+  DeferredResponse * deferResponse(unsigned long timeoutMs);
+  WakeupSocket * openWakeupSocket();
+  void sendDeferredResponse();
+  void releaseDeferredResponse();
+  void prepareResponse(HTTPResponse &res);
+  void callHandler(HTTPRequest * req, HTTPResponse * res, std::function<void()> handler);
+  void finishResponse(HTTPResponse &res);
+  void continueResponse();
+  void releaseResponse();
+#if HTTPS_COROUTINES
+  void * allocateFrame(size_t size);
+  Completion * createCompletion();
+  void startCoroutine(ResolvedResource &resolvedResource);
+  void finishCoroutine();
+  void releaseCoroutine();
+#endif
+  void processState();
   bool checkWebsocket();
+  bool checkKeepAlive();
 
-  // The receive buffer
+  // The receive buffer, used as ring buffer
   char _receiveBuffer[HTTPS_CONNECTION_DATA_CHUNK_SIZE];
 
-  // First index on _receive_buffer that has not been processed yet (anything before may be discarded)
-  int _bufferProcessed;
-  // The index on the receive_buffer that is the first one which is empty at the end.
-  int _bufferUnusedIdx;
+  // Index of the first byte in _receiveBuffer that has not been processed yet
+  size_t _bufferStart;
+  // Number of unprocessed bytes in _receiveBuffer, starting at _bufferStart (may wrap around)
+  size_t _bufferLength;
+  // Total number of bytes that have been received or processed, used to detect progress in loop()
+  unsigned long _bufferTransferred;
 
   // Socket address, length etc for the connection
   struct sockaddr _sockAddr;
@@ -140,10 +220,20 @@ private:
   // Resource resolver used to resolve resources
   ResourceResolver * _resResolver;
 
-  // The parser line. The struct is used to read the next line up to the \r\n in readLine()
+  // Memory for the request line and headers of the current request. Header values are stored as views
+  // on this memory, so it must not be reused before the request has been handled
+  char _requestArena[HTTPS_REQUEST_ARENA_SIZE];
+  // Number of bytes in _requestArena that are in use by headers of the current request
+  size_t _requestArenaUsed;
+
+  // The parser line. The struct is used to read the next line up to the \r\n in readLine(). The line is
+  // collected at the end of the used part of _requestArena. Only if it does not fit, it is moved to the
+  // overflow string on the heap
   struct {
-    std::string text = "";
+    size_t length = 0;
     bool parsingFinished = false;
+    bool overflow = false;
+    std::string overflowText = "";
   } _parserLine;
 
   // HTTP properties: Method, Request, Headers
@@ -151,12 +241,59 @@ private:
   std::string _httpResource;
   HTTPHeaders * _httpHeaders;
 
-  // Default headers that are applied to every response
-  HTTPHeaders * _defaultHeaders;
+  // Default headers that are applied to every response, serialized by the server
+  std::string const * _defaultHeaders;
+
+  // Buffers for the responses, owned by the server
+  ResponseBufferPool * _responseBuffers;
 
   // Should we use keep alive
   bool _isKeepAlive;
 
+  // Did the client send an HTTP/1.1 request (and does it therefore understand chunked encoding)
+  bool _isHTTP11;
+
+  // Number of requests that have been handled on this connection
+  uint16_t _requestCount;
+
+  // The client has sent further requests after the current one, so the response is collected in
+  // _outputQueue and sent together with the following ones
+  bool _pipelining;
+
+  // Data that has not been sent yet. It is sent when the socket becomes writable. Responses stop adding
+  // data once it holds HTTPS_OUTPUT_QUEUE_SIZE bytes, but a single write may exceed that
+  std::string _outputQueue;
+  // The socket did not accept the data at the start of _outputQueue the last time it was tried
+  bool _outputBlocked;
+  // Writing to the socket failed, further output is discarded
+  bool _outputError;
+
+  // Response that has been deferred by the handler of the current request, or NULL
+  DeferredResponse * _deferred;
+  // Time (ms) the connection waits for _deferred to be completed
+  unsigned long _deferredTimeout;
+  // Signalled when _deferred or another Completion is completed, to wake up the task that processes
+  // this connection
+  WakeupSocket * _wakeup;
+
+  // Response of the current request while the handler continues it in STATE_STREAMING, or NULL. It is
+  // constructed in _responseStorage, so that it outlives the call to processState() that called the
+  // handler
+  HTTPResponse * _response;
+  alignas(HTTPResponse) byte _responseStorage[sizeof(HTTPResponse)];
+
+#if HTTPS_COROUTINES
+  struct CoroutineContext;
+  // Request, response and coroutine of a coroutine handler that has not returned yet, or NULL
+  CoroutineContext * _coroutine;
+  // The coroutine is running right now, so it must not be destroyed
+  bool _coroutineRunning;
+  // Memory for the CoroutineContext and the frame of the coroutine
+  alignas(std::max_align_t) byte _coroutineArena[HTTPS_COROUTINE_ARENA_SIZE];
+  // Number of bytes at the start of _coroutineArena that are in use
+  size_t _coroutineArenaUsed;
+#endif
+
   //Websocket connection
   WebsocketHandler * _wsHandler;
 
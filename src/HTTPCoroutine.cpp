@@ -0,0 +1,159 @@
+#include "HTTPCoroutine.hpp"
+
+#if HTTPS_COROUTINES
+
+namespace httpsserver {
+
+HTTPCoroutine HTTPCoroutine::promise_type::get_return_object() noexcept {
+  return HTTPCoroutine(std::coroutine_handle<promise_type>::from_promise(*this));
+}
+
+/**
+ * Returned to the connection if the frame does not fit into its arena
+ */
+HTTPCoroutine HTTPCoroutine::promise_type::get_return_object_on_allocation_failure() noexcept {
+  return HTTPCoroutine();
+}
+
+/**
+ * An exception that leaves the handler ends the coroutine like a return
+ */
+void HTTPCoroutine::promise_type::unhandled_exception() noexcept {
+  HTTPS_LOGE("Coroutine handler has thrown an exception");
+}
+
+/**
+ * Allocates the frame from the arena of the connection. The arguments are those of the handler.
+ */
+void * HTTPCoroutine::promise_type::operator new(size_t size, HTTPRequest *, HTTPResponse * res) noexcept {
+  return res->_con->allocateFrame(size);
+}
+
+/**
+ * The arena is reset by the connection once the request has been handled, so nothing is done here
+ */
+void HTTPCoroutine::promise_type::operator delete(void *, size_t) noexcept {
+
+}
+
+HTTPCoroutine::HTTPCoroutine() noexcept:
+  _handle(nullptr) {
+
+}
+
+HTTPCoroutine::HTTPCoroutine(std::coroutine_handle<promise_type> handle) noexcept:
+  _handle(handle) {
+
+}
+
+HTTPCoroutine::HTTPCoroutine(HTTPCoroutine &&other) noexcept:
+  _handle(other._handle) {
+  other._handle = nullptr;
+}
+
+HTTPCoroutine &HTTPCoroutine::operator=(HTTPCoroutine &&other) noexcept {
+  if (this != &other) {
+    destroy();
+    _handle = other._handle;
+    other._handle = nullptr;
+  }
+  return *this;
+}
+
+HTTPCoroutine::~HTTPCoroutine() {
+  destroy();
+}
+
+/**
+ * Returns false if the coroutine could not be created, because its frame does not fit into the arena
+ */
+bool HTTPCoroutine::isValid() {
+  return (bool)_handle;
+}
+
+/**
+ * Returns true if the handler has returned
+ */
+bool HTTPCoroutine::isDone() {
+  return !_handle || _handle.done();
+}
+
+/**
+ * Returns true if the coroutine is suspended and what it awaits is ready
+ */
+bool HTTPCoroutine::canResume() {
+  return !isDone() && (_handle.promise()._awaiting == NULL || _handle.promise()._awaiting->isReady());
+}
+
+/**
+ * Continues the handler until it awaits something that is not ready or returns
+ */
+void HTTPCoroutine::resume() {
+  if (!isDone()) {
+    _handle.promise()._awaiting = NULL;
+    _handle.resume();
+  }
+}
+
+/**
+ * Destroys the frame, including the local variables of a handler that has not returned yet
+ */
+void HTTPCoroutine::destroy() {
+  if (_handle) {
+    _handle.destroy();
+    _handle = nullptr;
+  }
+}
+
+bool BodyAwaitable::isReady() {
+  return _req->isBodyAvailable();
+}
+
+bool WritableAwaitable::isReady() {
+  // More than the output queue can never be written without waiting
+  size_t length = _length < HTTPS_OUTPUT_QUEUE_SIZE ? _length : HTTPS_OUTPUT_QUEUE_SIZE;
+  return _res->availableForWrite() >= (int)length;
+}
+
+AwaitableCompletion::AwaitableCompletion(HTTPResponse * res) {
+  _completion = res->_con->createCompletion();
+}
+
+/**
+ * Drops the handler's reference. If the other task has not completed yet, it can see that with
+ * Completion::isCancelled().
+ */
+AwaitableCompletion::~AwaitableCompletion() {
+  _completion->cancel();
+  _completion->release();
+}
+
+/**
+ * Returns the Completion that has to be passed to the other task
+ */
+Completion * AwaitableCompletion::get() {
+  return _completion;
+}
+
+bool AwaitableCompletion::isReady() {
+  return _completion->isCompleted();
+}
+
+/**
+ * Waits until data of the request body can be read without waiting, or the body has been read completely
+ */
+BodyAwaitable awaitBody(HTTPRequest * req) {
+  return BodyAwaitable(req);
+}
+
+/**
+ * Waits until length bytes (at most HTTPS_OUTPUT_QUEUE_SIZE) can be written to the response without
+ * waiting for the client
+ */
+WritableAwaitable awaitWritable(HTTPResponse * res, size_t length) {
+  return WritableAwaitable(res, length);
+}
+
+} /* namespace httpsserver */
+
+#endif /* HTTPS_COROUTINES */
@@ -0,0 +1,154 @@
+#ifndef SRC_HTTPCOROUTINE_HPP_
+#define SRC_HTTPCOROUTINE_HPP_
+
+#include "HTTPSServerConstants.hpp"
+
+#if HTTPS_COROUTINES
+
+#include <Arduino.h>
+// Arduino declares it's own min max, incompatible with the stl...
+#undef min
+#undef max
+#include <coroutine>
+
+#include "HTTPRequest.hpp"
+#include "HTTPResponse.hpp"
+#include "Completion.hpp"
+
+namespace httpsserver {
+
+class HTTPAwaitable;
+
+/**
+ * \brief Return type of coroutine request handlers (C++20 only)
+ *
+ * A coroutine handler is registered with a ResourceNode like a regular handler function. It can wait
+ * for the request body, for the client to read the response or for another task with co_await, and
+ * the server continues with the other connections meanwhile:
+ *
+ *     HTTPCoroutine handleUpload(HTTPRequest * req, HTTPResponse * res) {
+ *       byte buffer[64];
+ *       while (!req->requestComplete()) {
+ *         co_await awaitBody(req);
+ *         size_t length = req->readBytes(buffer, sizeof(buffer));
+ *         ...
+ *       }
+ *       res->print("done");
+ *     }
+ *
+ * The frame of the coroutine is allocated from the arena of the connection (HTTPS_COROUTINE_ARENA_SIZE)
+ * and never from the heap. Therefore, only the awaitables below can be awaited, not other coroutines.
+ */
+class HTTPCoroutine {
+public:
+  struct promise_type {
+    HTTPCoroutine get_return_object() noexcept;
+    static HTTPCoroutine get_return_object_on_allocation_failure() noexcept;
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept;
+
+    static void * operator new(size_t size, HTTPRequest * req, HTTPResponse * res) noexcept;
+    static void operator delete(void * frame, size_t size) noexcept;
+
+    // What the coroutine waits for while it is suspended, or NULL
+    HTTPAwaitable * _awaiting = NULL;
+  };
+
+  HTTPCoroutine() noexcept;
+  HTTPCoroutine(HTTPCoroutine &&other) noexcept;
+  HTTPCoroutine &operator=(HTTPCoroutine &&other) noexcept;
+  HTTPCoroutine(HTTPCoroutine const &) = delete;
+  HTTPCoroutine &operator=(HTTPCoroutine const &) = delete;
+  ~HTTPCoroutine();
+
+  bool isValid();
+  bool isDone();
+  bool canResume();
+  void resume();
+  void destroy();
+
+private:
+  explicit HTTPCoroutine(std::coroutine_handle<promise_type> handle) noexcept;
+
+  std::coroutine_handle<promise_type> _handle;
+};
+
+/**
+ * \brief A callback function that will be called by the server to handle a request as a coroutine
+ */
+typedef HTTPCoroutine (HTTPSCoroutineFunction)(HTTPRequest * req, HTTPResponse * res);
+
+/**
+ * \brief Base class of everything a coroutine handler can co_await
+ *
+ * The connection checks isReady() to decide when to resume the coroutine.
+ */
+class HTTPAwaitable {
+public:
+  virtual ~HTTPAwaitable() {}
+  virtual bool isReady() = 0;
+
+  bool await_ready() { return isReady(); }
+  void await_suspend(std::coroutine_handle<HTTPCoroutine::promise_type> handle) { handle.promise()._awaiting = this; }
+  void await_resume() {}
+};
+
+/**
+ * \brief Ready when HTTPRequest::readBytes() returns data or the body has been read, see awaitBody()
+ */
+class BodyAwaitable : public HTTPAwaitable {
+public:
+  BodyAwaitable(HTTPRequest * req): _req(req) {}
+  bool isReady();
+
+private:
+  HTTPRequest * _req;
+};
+
+/**
+ * \brief Ready when the given number of bytes can be written without waiting, see awaitWritable()
+ */
+class WritableAwaitable : public HTTPAwaitable {
+public:
+  WritableAwaitable(HTTPResponse * res, size_t length): _res(res), _length(length) {}
+  bool isReady();
+
+private:
+  HTTPResponse * _res;
+  size_t _length;
+};
+
+/**
+ * \brief Completion that a coroutine handler waits for
+ *
+ * The handler passes get() to another task, which calls Completion::complete() when it is done, and
+ * awaits this object. If the connection is closed or times out before, the Completion is cancelled.
+ *
+ *     AwaitableCompletion done(res);
+ *     startMeasurement(done.get());
+ *     co_await done;
+ */
+class AwaitableCompletion : public HTTPAwaitable {
+public:
+  AwaitableCompletion(HTTPResponse * res);
+  AwaitableCompletion(AwaitableCompletion const &) = delete;
+  AwaitableCompletion &operator=(AwaitableCompletion const &) = delete;
+  virtual ~AwaitableCompletion();
+
+  Completion * get();
+  bool isReady();
+
+private:
+  Completion * _completion;
+};
+
+BodyAwaitable awaitBody(HTTPRequest * req);
+WritableAwaitable awaitWritable(HTTPResponse * res, size_t length);
+
+} /* namespace httpsserver */
+
+#endif /* HTTPS_COROUTINES */
+
+#endif /* SRC_HTTPCOROUTINE_HPP_ */
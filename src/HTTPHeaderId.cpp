@@ -0,0 +1,90 @@
+#include "HTTPHeaderId.hpp"
+
+namespace httpsserver {
+
+// Names of the well-known headers, in the order of HTTPHeaderId
+static const char * const HEADER_NAMES[HEADER_ID_COUNT] = {
+  "Host",
+  "Connection",
+  "Keep-Alive",
+  "Content-Length",
+  "Content-Type",
+  "Content-Encoding",
+  "Transfer-Encoding",
+  "Expect",
+  "Upgrade",
+  "Sec-WebSocket-Key",
+  "Sec-WebSocket-Version",
+  "Sec-WebSocket-Protocol",
+  "Sec-WebSocket-Extensions",
+  "Origin",
+  "Authorization",
+  "Cookie",
+  "Accept",
+  "Accept-Encoding",
+  "Accept-Language",
+  "If-None-Match",
+  "If-Modified-Since",
+  "Range",
+  "Referer",
+  "User-Agent",
+  "Cache-Control"
+};
+
+// FNV-1a over the lower-case characters of the name. The constexpr variant is used to create the case
+// labels in getHeaderId(), so two well-known names with the same hash fail to compile
+static constexpr char toLowerAscii(char c) {
+  return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
+
+static constexpr uint32_t hashHeaderLiteral(const char * s, uint32_t h = 2166136261u) {
+  return *s == '\0' ? h : hashHeaderLiteral(s + 1, (h ^ (uint8_t)toLowerAscii(*s)) * 16777619u);
+}
+
+uint32_t hashHeaderName(StringView const &name) {
+  uint32_t h = 2166136261u;
+  for(size_t i = 0; i < name.length(); i++) {
+    h = (h ^ (uint8_t)toLowerAscii(name[i])) * 16777619u;
+  }
+  return h;
+}
+
+HTTPHeaderId getHeaderId(StringView const &name) {
+  HTTPHeaderId id;
+  switch(hashHeaderName(name)) {
+    case hashHeaderLiteral("host"):                     id = HEADER_ID_HOST; break;
+    case hashHeaderLiteral("connection"):               id = HEADER_ID_CONNECTION; break;
+    case hashHeaderLiteral("keep-alive"):               id = HEADER_ID_KEEP_ALIVE; break;
+    case hashHeaderLiteral("content-length"):           id = HEADER_ID_CONTENT_LENGTH; break;
+    case hashHeaderLiteral("content-type"):             id = HEADER_ID_CONTENT_TYPE; break;
+    case hashHeaderLiteral("content-encoding"):         id = HEADER_ID_CONTENT_ENCODING; break;
+    case hashHeaderLiteral("transfer-encoding"):        id = HEADER_ID_TRANSFER_ENCODING; break;
+    case hashHeaderLiteral("expect"):                   id = HEADER_ID_EXPECT; break;
+    case hashHeaderLiteral("upgrade"):                  id = HEADER_ID_UPGRADE; break;
+    case hashHeaderLiteral("sec-websocket-key"):        id = HEADER_ID_SEC_WEBSOCKET_KEY; break;
+    case hashHeaderLiteral("sec-websocket-version"):    id = HEADER_ID_SEC_WEBSOCKET_VERSION; break;
+    case hashHeaderLiteral("sec-websocket-protocol"):   id = HEADER_ID_SEC_WEBSOCKET_PROTOCOL; break;
+    case hashHeaderLiteral("sec-websocket-extensions"): id = HEADER_ID_SEC_WEBSOCKET_EXTENSIONS; break;
+    case hashHeaderLiteral("origin"):                   id = HEADER_ID_ORIGIN; break;
+    case hashHeaderLiteral("authorization"):            id = HEADER_ID_AUTHORIZATION; break;
+    case hashHeaderLiteral("cookie"):                   id = HEADER_ID_COOKIE; break;
+    case hashHeaderLiteral("accept"):                   id = HEADER_ID_ACCEPT; break;
+    case hashHeaderLiteral("accept-encoding"):          id = HEADER_ID_ACCEPT_ENCODING; break;
+    case hashHeaderLiteral("accept-language"):          id = HEADER_ID_ACCEPT_LANGUAGE; break;
+    case hashHeaderLiteral("if-none-match"):            id = HEADER_ID_IF_NONE_MATCH; break;
+    case hashHeaderLiteral("if-modified-since"):        id = HEADER_ID_IF_MODIFIED_SINCE; break;
+    case hashHeaderLiteral("range"):                    id = HEADER_ID_RANGE; break;
+    case hashHeaderLiteral("referer"):                  id = HEADER_ID_REFERER; break;
+    case hashHeaderLiteral("user-agent"):               id = HEADER_ID_USER_AGENT; break;
+    case hashHeaderLiteral("cache-control"):            id = HEADER_ID_CACHE_CONTROL; break;
+    default: return HEADER_ID_UNKNOWN;
+  }
+  // Different names may have the same hash
+  return name.equalsIgnoreCase(StringView(HEADER_NAMES[id])) ? id : HEADER_ID_UNKNOWN;
+}
+
+const char * getHeaderName(HTTPHeaderId id) {
+  return (id < HEADER_ID_COUNT ? HEADER_NAMES[id] : "");
+}
+
+} /* namespace httpsserver */
@@ -0,0 +1,63 @@
+#ifndef SRC_HTTPHEADERID_HPP_
+#define SRC_HTTPHEADERID_HPP_
+
+#include <Arduino.h>
+
+#include "StringView.hpp"
+
+namespace httpsserver {
+
+/**
+ * Identifiers of well-known headers. Headers with these names are stored in fixed slots by HTTPHeaders,
+ * so looking them up does not require comparing strings.
+ */
+enum HTTPHeaderId {
+  HEADER_ID_HOST,
+  HEADER_ID_CONNECTION,
+  HEADER_ID_KEEP_ALIVE,
+  HEADER_ID_CONTENT_LENGTH,
+  HEADER_ID_CONTENT_TYPE,
+  HEADER_ID_CONTENT_ENCODING,
+  HEADER_ID_TRANSFER_ENCODING,
+  HEADER_ID_EXPECT,
+  HEADER_ID_UPGRADE,
+  HEADER_ID_SEC_WEBSOCKET_KEY,
+  HEADER_ID_SEC_WEBSOCKET_VERSION,
+  HEADER_ID_SEC_WEBSOCKET_PROTOCOL,
+  HEADER_ID_SEC_WEBSOCKET_EXTENSIONS,
+  HEADER_ID_ORIGIN,
+  HEADER_ID_AUTHORIZATION,
+  HEADER_ID_COOKIE,
+  HEADER_ID_ACCEPT,
+  HEADER_ID_ACCEPT_ENCODING,
+  HEADER_ID_ACCEPT_LANGUAGE,
+  HEADER_ID_IF_NONE_MATCH,
+  HEADER_ID_IF_MODIFIED_SINCE,
+  HEADER_ID_RANGE,
+  HEADER_ID_REFERER,
+  HEADER_ID_USER_AGENT,
+  HEADER_ID_CACHE_CONTROL,
+  /** Number of well-known headers */
+  HEADER_ID_COUNT,
+  /** Any other header */
+  HEADER_ID_UNKNOWN = HEADER_ID_COUNT
+};
+
+/**
+ * \brief Returns the id of a header name (case-insensitive), or HEADER_ID_UNKNOWN
+ */
+HTTPHeaderId getHeaderId(StringView const &name);
+
+/**
+ * \brief Returns the name of a well-known header
+ */
+const char * getHeaderName(HTTPHeaderId id);
+
+/**
+ * \brief Case-insensitive hash of a header name
+ */
+uint32_t hashHeaderName(StringView const &name);
+
+} /* namespace httpsserver */
+
+#endif /* SRC_HTTPHEADERID_HPP_ */
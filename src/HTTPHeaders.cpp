@@ -4,7 +4,7 @@ namespace httpsserver {
 
 HTTPHeaders::HTTPHeaders() {
   _headers = new std::vector<HTTPHeader *>();
-
+  clearViews();
 }
 
 HTTPHeaders::~HTTPHeaders() {
@@ -13,39 +13,207 @@ HTTPHeaders::~HTTPHeaders() {
 }
 
 HTTPHeader * HTTPHeaders::get(std::string const &name) {
-  for(std::vector<HTTPHeader*>::iterator header = _headers->begin(); header != _headers->end(); ++header) {
-    if ((*header)->_name.compare(name)==0) {
-      return (*header);
-    }
-  }
-  return NULL;
+  materializeViews();
+  int idx = findHeader(StringView(name));
+  return (idx < 0 ? NULL : (*_headers)[idx]);
 }
 
 std::string HTTPHeaders::getValue(std::string const &name) {
-  for(std::vector<HTTPHeader*>::iterator header = _headers->begin(); header != _headers->end(); ++header) {
-    if ((*header)->_name.compare(name)==0) {
-      return ((*header)->_value);
+  return getView(StringView(name)).toString();
+}
+
+
+void HTTPHeaders::set(HTTPHeader * header) {
+  materializeViews();
+  int idx = findHeader(StringView(header->_name));
+  if (idx >= 0) {
+    delete (*_headers)[idx];
+    (*_headers)[idx] = header;
+    return;
+  }
+  _headers->push_back(header);
+}
+
+/**
+ * Returns the value of the header with the given name without copying it, or an empty view if the
+ * header is not set.
+ *
+ * The view is valid until the header is changed or the headers are cleared.
+ */
+StringView HTTPHeaders::getView(StringView const &name) {
+  if (!_views.empty()) {
+    HTTPHeaderId id = getHeaderId(name);
+    int idx = findView(name, id, id == HEADER_ID_UNKNOWN ? hashHeaderName(name) : 0);
+    if (idx >= 0) {
+      return _views[idx].value;
     }
   }
-  return "";
+  int idx = findHeader(name);
+  return (idx < 0 ? StringView() : StringView((*_headers)[idx]->_value));
 }
 
+/**
+ * Like getView(name), but for a well-known header. Does not need to compare any strings if the
+ * headers are stored as views.
+ */
+StringView HTTPHeaders::getView(HTTPHeaderId id) {
+  if (id >= HEADER_ID_COUNT) {
+    return StringView();
+  }
+  if (_wellKnownViews[id] >= 0) {
+    return _views[_wellKnownViews[id]].value;
+  }
+  if (_headers->empty()) {
+    return StringView();
+  }
+  int idx = findHeader(StringView(getHeaderName(id)));
+  return (idx < 0 ? StringView() : StringView((*_headers)[idx]->_value));
+}
 
-void HTTPHeaders::set(HTTPHeader * header) {
-  for(int i = 0; i < _headers->size(); i++) {
-    if ((*_headers)[i]->_name.compare(header->_name)==0) {
-      delete (*_headers)[i];
-      (*_headers)[i] = header;
-      return;
+/**
+ * Sets a header without copying name and value. The caller has to make sure that the memory the views
+ * refer to stays valid until the headers are cleared.
+ */
+void HTTPHeaders::setView(StringView const &name, StringView const &value) {
+  HTTPHeaderId id = getHeaderId(name);
+  uint32_t hash = (id == HEADER_ID_UNKNOWN ? hashHeaderName(name) : 0);
+
+  int idx = findView(name, id, hash);
+  if (idx >= 0) {
+    _views[idx].value = value;
+    return;
+  }
+
+  idx = findHeader(name);
+  if (idx >= 0) {
+    delete (*_headers)[idx];
+    _headers->erase(_headers->begin() + idx);
+  }
+
+  if (_views.capacity() == 0) {
+    // The storage is kept by clearAll(), so this usually happens only once
+    _views.reserve(HTTPS_REQUEST_MAX_HEADERS);
+  }
+  HeaderView header;
+  header.name = name;
+  header.value = value;
+  _views.push_back(header);
+  int8_t viewIdx = (_views.size() <= 127 ? (int8_t)(_views.size() - 1) : -1);
+
+  if (id != HEADER_ID_UNKNOWN) {
+    if (viewIdx >= 0) {
+      _wellKnownViews[id] = viewIdx;
+    } else {
+      _otherViewsOverflow = true;
     }
+  } else {
+    for (int i = 0; i < HTTPS_HEADER_HASH_SLOTS; i++) {
+      int slot = (hash + i) % HTTPS_HEADER_HASH_SLOTS;
+      if (_otherViews[slot] < 0) {
+        _otherViews[slot] = viewIdx;
+        if (viewIdx < 0) {
+          _otherViewsOverflow = true;
+        }
+        return;
+      }
+    }
+    _otherViewsOverflow = true;
+  }
+}
+
+/**
+ * Returns true if a header with the given name is set (even if its value is empty)
+ */
+bool HTTPHeaders::contains(StringView const &name) {
+  if (!_views.empty()) {
+    HTTPHeaderId id = getHeaderId(name);
+    if (findView(name, id, id == HEADER_ID_UNKNOWN ? hashHeaderName(name) : 0) >= 0) {
+      return true;
+    }
+  }
+  return findHeader(name) >= 0;
+}
+
+/**
+ * Appends all headers to out, each one like "Name: value\r\n"
+ */
+void HTTPHeaders::serialize(std::string &out) {
+  materializeViews();
+  for(std::vector<HTTPHeader*>::iterator header = _headers->begin(); header != _headers->end(); ++header) {
+    out += (*header)->_name;
+    out += ": ";
+    out += (*header)->_value;
+    out += "\r\n";
   }
-  _headers->push_back(header);
 }
 
 std::vector<HTTPHeader *> * HTTPHeaders::getAll() {
+  materializeViews();
   return _headers;
 }
 
+/**
+ * Returns the index of the view with the given name in _views, or -1
+ */
+int HTTPHeaders::findView(StringView const &name, HTTPHeaderId id, uint32_t hash) {
+  if (id != HEADER_ID_UNKNOWN) {
+    if (_wellKnownViews[id] >= 0 || !_otherViewsOverflow) {
+      return _wellKnownViews[id];
+    }
+  } else {
+    for (int i = 0; i < HTTPS_HEADER_HASH_SLOTS; i++) {
+      int idx = _otherViews[(hash + i) % HTTPS_HEADER_HASH_SLOTS];
+      if (idx < 0) {
+        break;
+      }
+      if (_views[idx].name.equalsIgnoreCase(name)) {
+        return idx;
+      }
+    }
+    if (!_otherViewsOverflow) {
+      return -1;
+    }
+  }
+  // Some views could not be indexed
+  for (size_t i = 0; i < _views.size(); i++) {
+    if (_views[i].name.equalsIgnoreCase(name)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Returns the index of the HTTPHeader object with the given name in _headers, or -1
+ */
+int HTTPHeaders::findHeader(StringView const &name) {
+  for (size_t i = 0; i < _headers->size(); i++) {
+    if (name.equalsIgnoreCase(StringView((*_headers)[i]->_name))) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Converts all headers that are stored as views to HTTPHeader objects
+ */
+void HTTPHeaders::materializeViews() {
+  if (!_views.empty()) {
+    for(std::vector<HeaderView>::iterator header = _views.begin(); header != _views.end(); ++header) {
+      _headers->push_back(new HTTPHeader(header->name.toString(), header->value.toString()));
+    }
+    clearViews();
+  }
+}
+
+void HTTPHeaders::clearViews() {
+  _views.clear();
+  memset(_wellKnownViews, -1, sizeof(_wellKnownViews));
+  memset(_otherViews, -1, sizeof(_otherViews));
+  _otherViewsOverflow = false;
+}
+
 /**
  * Deletes all headers
  */
@@ -54,6 +222,7 @@ void HTTPHeaders::clearAll() {
     delete (*header);
   }
   _headers->clear();
+  clearViews();
 }
 
 } /* namespace httpsserver */
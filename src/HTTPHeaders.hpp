@@ -9,11 +9,20 @@
 
 #include "HTTPSServerConstants.hpp"
 #include "HTTPHeader.hpp"
+#include "HTTPHeaderId.hpp"
+#include "StringView.hpp"
 
 namespace httpsserver {
 
 /**
  * \brief Groups and manages a set of HTTPHeader instances
+ *
+ * Besides HTTPHeader objects, the headers of a request can also be stored as views on the memory of
+ * the connection, which avoids copying them. These are converted to HTTPHeader objects only if a
+ * function that works with HTTPHeader pointers is used.
+ *
+ * Header names are compared case-insensitive. Views of well-known headers (see HTTPHeaderId) are found
+ * by their id, other views by a small hash table.
  */
 class HTTPHeaders {
 public:
@@ -24,12 +33,38 @@ public:
   std::string getValue(std::string const &name);
   void set(HTTPHeader * header);
 
+  StringView getView(StringView const &name);
+  StringView getView(HTTPHeaderId id);
+  void setView(StringView const &name, StringView const &value);
+  bool contains(StringView const &name);
+
+  void serialize(std::string &out);
+
   std::vector<HTTPHeader *> * getAll();
 
   void clearAll();
 
 private:
+  // Header stored as views on memory that is owned by someone else (i.e. the connection)
+  struct HeaderView {
+    StringView name;
+    StringView value;
+  };
+
+  int findView(StringView const &name, HTTPHeaderId id, uint32_t hash);
+  int findHeader(StringView const &name);
+  void materializeViews();
+  void clearViews();
+
   std::vector<HTTPHeader*> * _headers;
+  std::vector<HeaderView> _views;
+
+  // Index in _views for each well-known header, or -1
+  int8_t _wellKnownViews[HEADER_ID_COUNT];
+  // Hash table (open addressing) with the index in _views for other headers, or -1
+  int8_t _otherViews[HTTPS_HEADER_HASH_SLOTS];
+  // Set if _otherViews has been full, so some headers can only be found by a linear search
+  bool _otherViewsOverflow;
 };
 
 } /* namespace httpsserver */
@@ -6,9 +6,9 @@ HTTPRequest::HTTPRequest(
     ConnectionContext * con,
     HTTPHeaders * headers,
     HTTPNode * resolvedNode,
-    std::string method,
+    std::string const &method,
     ResourceParameters * params,
-    std::string requestString):
+    std::string const &requestString):
   _con(con),
   _headers(headers),
   _resolvedNode(resolvedNode),
@@ -16,12 +16,14 @@ HTTPRequest::HTTPRequest(
   _params(params),
   _requestString(requestString) {
 
-  HTTPHeader * contentLength = headers->get("Content-Length");
-  if (contentLength == NULL) {
+  StringView contentLength = headers->getView(HEADER_ID_CONTENT_LENGTH);
+  if (contentLength.empty()) {
     _remainingContent = 0;
-    _contentLengthSet = false;
+    // On a keep-alive connection, a request without length has no body. Everything that follows
+    // belongs to the next request
+    _contentLengthSet = (con->getCacheSize() > 0);
   } else {
-    _remainingContent = parseInt(contentLength->_value);
+    _remainingContent = parseUInt(contentLength.data(), contentLength.length());
     _contentLengthSet = true;
   }
 
@@ -37,12 +39,23 @@ ResourceParameters * HTTPRequest::getParams() {
 }
 
 std::string HTTPRequest::getHeader(std::string const &name) {
-  HTTPHeader * h = _headers->get(name);
-  if (h != NULL) {
-    return h->_value;
-  } else {
-    return std::string();
-  }
+  return _headers->getView(StringView(name)).toString();
+}
+
+/**
+ * Returns the value of a request header without copying it, or an empty view if the header is not set.
+ *
+ * The view is only valid while the request is handled.
+ */
+StringView HTTPRequest::getHeaderView(StringView const &name) {
+  return _headers->getView(name);
+}
+
+/**
+ * Like getHeaderView(name), but for a well-known header (like HEADER_ID_ACCEPT_ENCODING)
+ */
+StringView HTTPRequest::getHeaderView(HTTPHeaderId id) {
+  return _headers->getView(id);
 }
 
 void HTTPRequest::setHeader(std::string const &name, std::string const &value) {
@@ -84,11 +97,11 @@ size_t HTTPRequest::getContentLength() {
   return _remainingContent;
 }
 
-std::string HTTPRequest::getRequestString() {
+std::string const &HTTPRequest::getRequestString() {
   return _requestString;
 }
 
-std::string HTTPRequest::getMethod() {
+std::string const &HTTPRequest::getMethod() {
   return _method;
 }
 
@@ -106,6 +119,14 @@ bool HTTPRequest::requestComplete() {
   }
 }
 
+/**
+ * Returns true if readBytes() returns data without waiting for the client, or if the body has been
+ * read completely
+ */
+bool HTTPRequest::isBodyAvailable() {
+  return requestComplete() || _con->pendingBufferSize() > 0;
+}
+
 /**
  * This function will drop whatever is remaining of the request body
  */
@@ -137,7 +158,7 @@ std::string HTTPRequest::getBasicAuthPassword() {
 }
 
 std::string HTTPRequest::decodeBasicAuthToken() {
-  std::string basicAuthString = getHeader("Authorization");
+  std::string basicAuthString = _headers->getView(HEADER_ID_AUTHORIZATION).toString();
   // Get the length of the token
   size_t sourceLength = basicAuthString.length();
   // Only handle basic auth tokens
@@ -11,6 +11,7 @@
 #include "HTTPNode.hpp"
 #include "HTTPHeader.hpp"
 #include "HTTPHeaders.hpp"
+#include "StringView.hpp"
 #include "ResourceParameters.hpp"
 #include "util.hpp"
 
@@ -21,14 +22,16 @@ namespace httpsserver {
  */
 class HTTPRequest {
 public:
-  HTTPRequest(ConnectionContext * con, HTTPHeaders * headers, HTTPNode * resolvedNode, std::string method, ResourceParameters * params, std::string requestString);
+  HTTPRequest(ConnectionContext * con, HTTPHeaders * headers, HTTPNode * resolvedNode, std::string const &method, ResourceParameters * params, std::string const &requestString);
   virtual ~HTTPRequest();
 
   std::string getHeader(std::string const &name);
+  StringView getHeaderView(StringView const &name);
+  StringView getHeaderView(HTTPHeaderId id);
   void setHeader(std::string const &name, std::string const &value);
   HTTPNode * getResolvedNode();
-  std::string getRequestString();
-  std::string getMethod();
+  std::string const &getRequestString();
+  std::string const &getMethod();
   std::string getTag();
   IPAddress getClientIP();
 
@@ -36,6 +39,7 @@ public:
   size_t readBytes(byte * buffer, size_t length);
   size_t getContentLength();
   bool   requestComplete();
+  bool   isBodyAvailable();
   void   discardRequestBody();
   ResourceParameters * getParams();
   std::string getBasicAuthUser();
@@ -52,11 +56,12 @@ private:
 
   HTTPNode * _resolvedNode;
 
-  std::string _method;
+  // Method and request string are owned by the connection
+  std::string const &_method;
 
   ResourceParameters * _params;
 
-  std::string _requestString;
+  std::string const &_requestString;
 
   bool _contentLengthSet;
   size_t _remainingContent;
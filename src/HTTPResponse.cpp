@@ -13,21 +13,47 @@ HTTPResponse::HTTPResponse(ConnectionContext * con):
   _statusText = "OK";
   _headerWritten = false;
   _isError = false;
+  _isChunked = false;
+  _flushEachWrite = false;
+  _isFixedLength = false;
+  _contentLength = 0;
+  _contentWritten = 0;
+  _contentOverflow = false;
+  _defaultHeaders = NULL;
+  _serializedHeaders = NULL;
+  _compressionPending = false;
+  _compressionFormat = DEFLATE_GZIP;
+  _compressionWindowBits = HTTPS_COMPRESSION_WINDOW_BITS;
+  _compressionMemLevel = HTTPS_COMPRESSION_MEM_LEVEL;
+  _encoder = NULL;
+  _isDeferred = false;
+  _writableCallback = NULL;
+  _nonBlocking = false;
+  _writeRefused = false;
 
   _responseCacheSize = con->getCacheSize();
   _responseCachePointer = 0;
+  _responseCache = NULL;
+  _ownsResponseCache = false;
   if (_responseCacheSize > 0) {
-    HTTPS_LOGD("Creating buffered response, size: %d", _responseCacheSize);
-    _responseCache = new byte[_responseCacheSize];
+    _responseCache = con->acquireResponseBuffer();
+    if (_responseCache != NULL) {
+      HTTPS_LOGD("Creating buffered response, size: %d", _responseCacheSize);
+    } else {
+      // Without a buffer, the length of the response is unknown and the connection cannot be reused
+      HTTPS_LOGW("No response buffer available, streaming the response");
+      _responseCacheSize = 0;
+      setHeader("Connection", "close");
+    }
   } else {
     HTTPS_LOGD("Creating non-buffered response");
-    _responseCache = NULL;
   }
 }
 
 HTTPResponse::~HTTPResponse() {
+  delete _encoder;
   if (_responseCache != NULL) {
-    delete[] _responseCache;
+    releaseResponseCache();
   }
   _headers.clearAll();
 }
@@ -52,6 +78,27 @@ void HTTPResponse::setHeader(std::string const &name, std::string const &value)
   _headers.set(new HTTPHeader(name, value));
 }
 
+/**
+ * Sets the default headers of the server, serialized like "Name: value\r\n". Headers that are set with
+ * setHeader() replace default headers with the same name.
+ *
+ * The string is not copied and has to be valid until the header has been written.
+ */
+void HTTPResponse::setDefaultHeaders(std::string const * defaultHeaders) {
+  _defaultHeaders = defaultHeaders;
+}
+
+/**
+ * Adds headers that are already serialized like "Name: value\r\n", e.g. from a table in flash. This
+ * avoids creating an HTTPHeader for each of them. A header must not be contained in the string and also
+ * be set with setHeader().
+ *
+ * The string is not copied and has to be valid until the header has been written.
+ */
+void HTTPResponse::setSerializedHeaders(const char * headers) {
+  _serializedHeaders = headers;
+}
+
 bool HTTPResponse::isHeaderWritten() {
   return _headerWritten;
 }
@@ -60,9 +107,167 @@ bool HTTPResponse::isResponseBuffered() {
   return _responseCache != NULL;
 }
 
+/**
+ * Returns true if the client can tell where the response ends, so that the connection can be used for
+ * the next request. This is the case as long as the response is buffered or sent in chunks, or if it
+ * has a fixed length and exactly that many bytes have been written. A response that may be missing
+ * data because a write has been refused is never followed by another one.
+ */
+bool HTTPResponse::isKeepAlivePossible() {
+  if (_writeRefused) {
+    return false;
+  }
+  if (_isFixedLength) {
+    return _con->getCacheSize() > 0 && _contentWritten == _contentLength;
+  }
+  return isResponseBuffered();
+}
+
+/**
+ * Requests that the response is sent with Transfer-Encoding: chunked. Each call to write() is then
+ * sent to the client immediately as a chunk, while the connection can still be kept alive.
+ *
+ * Has to be called before anything has been written. If the client does not support chunked encoding
+ * or does not use keep-alive, the response is sent as usual.
+ */
+void HTTPResponse::setChunkedEncoding() {
+  if (!_headerWritten && startChunkedEncoding()) {
+    _flushEachWrite = true;
+    // Data that has been buffered so far is the first chunk
+    if (_responseCachePointer > 0) {
+      sendChunk(false);
+    }
+  }
+}
+
+/**
+ * Sets the length of the response body in advance. The header is sent immediately and the body is
+ * streamed to the client without buffering, while the connection can still be kept alive.
+ *
+ * Has to be called after the status and all headers have been set, and before any data is sent. The
+ * handler then has to write exactly contentLength bytes. If it writes less, the connection is closed
+ * after the response, additional bytes are discarded.
+ */
+void HTTPResponse::setContentLength(size_t contentLength) {
+  if (_headerWritten || _isChunked || _isFixedLength || _encoder != NULL) {
+    HTTPS_LOGE("setContentLength() has to be called before any data is sent");
+    return;
+  }
+  _headers.set(new HTTPHeader("Content-Length", intToString(contentLength)));
+  if (_con->getCacheSize() > 0) {
+    // The client requested keep-alive. We need no buffer to support it, as the length is known
+    setHeader("Connection", "keep-alive");
+  }
+  _isFixedLength = true;
+  _contentLength = contentLength;
+  _contentWritten = 0;
+
+  if (_responseCache != NULL) {
+    // Data that has been buffered so far is sent together with the header. The buffer is not needed
+    // anymore and can be used by other responses
+    _contentWritten = std::min(_responseCachePointer, _contentLength);
+    _contentOverflow = (_responseCachePointer > _contentLength);
+    writeCache(_responseCache + HTTPS_CHUNK_PREFIX_SIZE, _contentWritten);
+    releaseResponseCache();
+    _responseCachePointer = 0;
+  } else {
+    printHeader();
+  }
+}
+
+/**
+ * Compresses the body with gzip or deflate, if the client accepts one of them. acceptEncoding is the
+ * Accept-Encoding header of the request, windowBits and memLevel define how much memory is used for
+ * the compression (see DeflateEncoder).
+ *
+ * The body is only compressed once HTTPS_COMPRESSION_MIN_SIZE bytes have been written, so small
+ * responses are sent as they are. To find out, the response is buffered even if the connection is not
+ * kept alive (unless the pool of response buffers is exhausted). Responses with a Content-Encoding or Content-Length header, or that
+ * use setContentLength(), are not compressed either, and neither are formats that are compressed
+ * already (like most images). If the compressed body does not fit into the buffer, it is sent with
+ * Transfer-Encoding: chunked, or the connection is closed after it if the client does not support that.
+ *
+ * Has to be called before anything has been written. Returns true if the client accepts compression.
+ */
+bool HTTPResponse::setCompression(StringView const &acceptEncoding, uint8_t windowBits, uint8_t memLevel) {
+  if (_headerWritten || _encoder != NULL) {
+    return false;
+  }
+  if (acceptsEncoding(acceptEncoding, "gzip")) {
+    _compressionFormat = DEFLATE_GZIP;
+  } else if (acceptsEncoding(acceptEncoding, "deflate")) {
+    _compressionFormat = DEFLATE_ZLIB;
+  } else {
+    _compressionPending = false;
+    return false;
+  }
+  _compressionPending = true;
+  _compressionWindowBits = windowBits;
+  _compressionMemLevel = memLevel;
+  // The decision can only be postponed until the size is known if the data is buffered meanwhile. So
+  // a buffer is used even if the connection is not kept alive
+  if (_responseCache == NULL && !_isFixedLength) {
+    _responseCache = _con->acquireResponseBuffer();
+    if (_responseCache != NULL) {
+      _responseCacheSize = HTTPS_KEEPALIVE_CACHESIZE;
+    }
+  }
+  return true;
+}
+
+/**
+ * Replaces the buffer from the pool of the server by one on the heap, so that other responses can use
+ * the pool buffer. Called by the connection before a coroutine handler waits for something, which may
+ * take a while.
+ */
+void HTTPResponse::detachResponseBuffer() {
+  if (_responseCache == NULL || _ownsResponseCache) {
+    return;
+  }
+  byte * buffer = new byte[HTTPS_RESPONSE_BUFFER_SIZE];
+  memcpy(buffer + HTTPS_CHUNK_PREFIX_SIZE, _responseCache + HTTPS_CHUNK_PREFIX_SIZE, _responseCachePointer);
+  _con->releaseResponseBuffer(_responseCache);
+  _responseCache = buffer;
+  _ownsResponseCache = true;
+}
+
+/**
+ * Returns the buffer to where it came from
+ */
+void HTTPResponse::releaseResponseCache() {
+  if (_ownsResponseCache) {
+    delete[] _responseCache;
+  } else {
+    _con->releaseResponseBuffer(_responseCache);
+  }
+  _responseCache = NULL;
+}
+
 void HTTPResponse::finalize() {
-  if (isResponseBuffered()) {
+  if (_writeRefused) {
+    HTTPS_LOGW("The client did not read fast enough, the response is incomplete");
+  }
+  if (_encoder != NULL) {
+    _encoder->finish();
+    delete _encoder;
+    _encoder = NULL;
+  }
+  if (_isFixedLength) {
+    if (_contentOverflow || _contentWritten != _contentLength) {
+      HTTPS_LOGE("Response body does not match its Content-Length (%u bytes written, %u expected%s)",
+        _contentWritten, _contentLength, _contentOverflow ? ", more data discarded" : "");
+    }
+  } else if (_isChunked) {
+    // Send the rest of the data together with the last chunk. Without the last chunk, the client can
+    // tell that an incomplete response has been cut off when the connection is closed
+    sendChunk(!_writeRefused);
+    releaseResponseCache();
+    _isChunked = false;
+  } else if (isResponseBuffered()) {
     drainBuffer();
+  } else {
+    // Make sure that the header is sent even if there is no body
+    printHeader();
   }
 }
 
@@ -75,8 +280,30 @@ void HTTPResponse::printStd(const std::string &str) {
 
 /**
  * Writes bytes to the response. May be called several times.
+ *
+ * If the output queue of the connection is full, the call waits until the client has read enough data
+ * or the connection times out, and the other clients are not served meanwhile. Once the handler has
+ * called availableForWrite() or onWritable(), the call never waits. Instead, nothing is written and 0
+ * is returned while the queue is full, and the handler continues with onWritable().
  */
 size_t  HTTPResponse::write(const uint8_t *buffer, size_t size) {
+  if (_isDeferred) {
+    return 0;
+  }
+  if (_compressionPending) {
+    checkCompression(size);
+  }
+  if (!canWrite(size) && (_nonBlocking || !_con->waitForWritable())) {
+    _writeRefused = true;
+    return 0;
+  }
+  if (_encoder != NULL) {
+    _encoder->write(buffer, size);
+    if (_flushEachWrite) {
+      _encoder->flush();
+    }
+    return size;
+  }
   if(!isResponseBuffered()) {
     printHeader();
   }
@@ -87,11 +314,67 @@ size_t  HTTPResponse::write(const uint8_t *buffer, size_t size) {
  * Writes a single byte to the response.
  */
 size_t  HTTPResponse::write(uint8_t b) {
-  if(!isResponseBuffered()) {
-    printHeader();
-  }
   byte ba[] = {b};
-  return writeBytesInternal(ba, 1);
+  return write(ba, 1);
+}
+
+/**
+ * Returns the number of bytes that fit into the output queue of the connection.
+ *
+ * From now on, write() does not wait for the client. A larger write is still taken as a whole, but while
+ * this is 0, write() refuses all data that does not fit into the buffer of the response. Handlers that
+ * stream large responses to clients on slow networks can use this to write in pieces that fit.
+ */
+int HTTPResponse::availableForWrite() {
+  _nonBlocking = true;
+  return _con->getOutputSpace();
+}
+
+/**
+ * Continues the body after the handler has returned. The connection calls the callback whenever the
+ * output queue has space (see availableForWrite()), while it serves the other connections, until the
+ * callback returns false. The callback writes to this response like the handler did, and returns true
+ * to be called again, e.g. once a write has been refused.
+ *
+ * The response object stays valid until then, but the request does not, so everything else the callback
+ * needs has to be captured by value. Not supported for coroutine handlers, which use awaitWritable().
+ */
+void HTTPResponse::onWritable(std::function<bool()> callback) {
+  _nonBlocking = true;
+  _writableCallback = callback;
+}
+
+/**
+ * Returns true if the body is continued by a callback that has been set with onWritable()
+ */
+bool HTTPResponse::hasWritableCallback() {
+  return (bool)_writableCallback;
+}
+
+/**
+ * Called by the connection whenever the output queue has space. Calls the callback that has been set
+ * with onWritable() and returns false once it has finished the body.
+ */
+bool HTTPResponse::continueWriting() {
+  // Only writes of the last call can be missing, earlier ones have been repeated by the callback
+  _writeRefused = false;
+  if (_writableCallback && _writableCallback()) {
+    return true;
+  }
+  _writableCallback = NULL;
+  return false;
+}
+
+/**
+ * Returns true if length bytes can be written right now. This is the case if they go to the buffer, or
+ * if the output queue of the connection is not full.
+ */
+bool HTTPResponse::canWrite(size_t length) {
+  if (isResponseBuffered() && !_flushEachWrite && _encoder == NULL &&
+      length <= _responseCacheSize - _responseCachePointer) {
+    return true;
+  }
+  return _con->getOutputSpace() > 0;
 }
 
 /**
@@ -100,19 +383,126 @@ size_t  HTTPResponse::write(uint8_t b) {
 void HTTPResponse::printHeader() {
   if (!_headerWritten) {
     HTTPS_LOGD("Printing headers");
+    // All of the header is sent with a single write, so it ends up in one TLS record
+    printInternal(serializeHeader(), true);
+    _headerWritten=true;
+  }
+}
+
+/**
+ * Returns the status line and all headers, including the blank line that terminates them
+ */
+std::string HTTPResponse::serializeHeader() {
+  std::vector<HTTPHeader *> * headers = _headers.getAll();
+
+  std::string header;
+  size_t length = _statusText.length() + 16 + (_defaultHeaders != NULL ? _defaultHeaders->length() : 0) +
+    (_serializedHeaders != NULL ? strlen(_serializedHeaders) : 0);
+  for(std::vector<HTTPHeader*>::iterator h = headers->begin(); h != headers->end(); ++h) {
+    length += (*h)->_name.length() + (*h)->_value.length() + 4;
+  }
+  header.reserve(length);
 
-    // Status line, like: "HTTP/1.1 200 OK\r\n"
-    std::string statusLine = "HTTP/1.1 " + intToString(_statusCode) + " " + _statusText + "\r\n";
-    printInternal(statusLine, true);
+  // Status line, like: "HTTP/1.1 200 OK\r\n"
+  header += "HTTP/1.1 ";
+  header += intToString(_statusCode);
+  header += ' ';
+  header += _statusText;
+  header += "\r\n";
 
-    // Each header, like: "Host: myEsp32\r\n"
-    std::vector<HTTPHeader *> * headers = _headers.getAll();
-    for(std::vector<HTTPHeader*>::iterator header = headers->begin(); header != headers->end(); ++header) {
-      printInternal((*header)->print()+"\r\n", true);
+  serializeDefaultHeaders(header);
+  if (_serializedHeaders != NULL) {
+    header += _serializedHeaders;
+  }
+
+  // Each header, like: "Host: myEsp32\r\n"
+  for(std::vector<HTTPHeader*>::iterator h = headers->begin(); h != headers->end(); ++h) {
+    header += (*h)->_name;
+    header += ": ";
+    header += (*h)->_value;
+    header += "\r\n";
+  }
+  header += "\r\n";
+
+  return header;
+}
+
+/**
+ * Appends the default headers to out, except those that have been set for this response
+ */
+void HTTPResponse::serializeDefaultHeaders(std::string &out) {
+  if (_defaultHeaders == NULL) {
+    return;
+  }
+  const std::string &block = *_defaultHeaders;
+
+  // Lines that are not overridden are copied in runs, usually the whole block at once
+  size_t runStart = 0;
+  size_t lineStart = 0;
+  while (lineStart < block.length()) {
+    size_t lineEnd = block.find("\r\n", lineStart);
+    lineEnd = (lineEnd == std::string::npos ? block.length() : lineEnd + 2);
+    size_t colon = block.find(':', lineStart);
+    if (colon < lineEnd && isHeaderSet(StringView(block.data() + lineStart, colon - lineStart))) {
+      out.append(block, runStart, lineStart - runStart);
+      runStart = lineEnd;
     }
-    printInternal("\r\n", true);
+    lineStart = lineEnd;
+  }
+  out.append(block, runStart, block.length() - runStart);
+}
 
-    _headerWritten=true;
+/**
+ * Returns true if the response has a header with the given name, either set by setHeader() or contained
+ * in the serialized headers
+ */
+bool HTTPResponse::isHeaderSet(StringView const &name) {
+  if (_headers.contains(name)) {
+    return true;
+  }
+  if (_serializedHeaders != NULL) {
+    const char * line = _serializedHeaders;
+    while (*line != '\0') {
+      const char * colon = strchr(line, ':');
+      if (colon == NULL) {
+        break;
+      }
+      if (name.equalsIgnoreCase(StringView(line, colon - line))) {
+        return true;
+      }
+      const char * lineEnd = strchr(colon, '\n');
+      if (lineEnd == NULL) {
+        break;
+      }
+      line = lineEnd + 1;
+    }
+  }
+  return false;
+}
+
+/**
+ * Writes length bytes of the cache, starting at data, to the client. If the header has not been
+ * written yet and both fit into the cache, the data is moved behind the header and everything is
+ * sent with a single write.
+ *
+ * The content of the cache is invalid afterwards.
+ */
+void HTTPResponse::writeCache(byte * data, size_t length) {
+  if (!_headerWritten) {
+    HTTPS_LOGD("Printing headers");
+    std::string header = serializeHeader();
+    _headerWritten = true;
+    if (header.length() + length <= HTTPS_CHUNK_PREFIX_SIZE + _responseCacheSize + HTTPS_CHUNK_SUFFIX_SIZE) {
+      memmove(_responseCache + header.length(), data, length);
+      memcpy(_responseCache, header.data(), header.length());
+      writeBytesInternal(_responseCache, header.length() + length, true);
+      return;
+    }
+    printInternal(header, true);
+  }
+  // Check for 0 as it may be an overflow reaction without any data that has been written earlier
+  if (length > 0) {
+    writeBytesInternal(data, length, true);
   }
 }
 
@@ -123,23 +513,73 @@ void HTTPResponse::error() {
   _con->signalRequestError();
 }
 
+/**
+ * Defers the response, so that it can be completed by another task.
+ *
+ * A handler that has to wait for something (e.g. a sensor or another task) calls this instead of
+ * writing the response and passes the returned object on. The connection then waits without holding
+ * up the server until DeferredResponse::complete() is called. If that does not happen within timeoutMs
+ * milliseconds, the client receives a 503 response and the deferred response is cancelled.
+ *
+ * The status and the headers that have been set so far are copied to the deferred response. Returns
+ * NULL if the response has already been started (e.g. data has been written) and cannot be deferred.
+ */
+DeferredResponse * HTTPResponse::defer(unsigned long timeoutMs) {
+  if (_isDeferred || _headerWritten || _responseCachePointer > 0 || _isChunked || _isFixedLength || _encoder != NULL) {
+    HTTPS_LOGE("defer() has to be called before any data is written");
+    return NULL;
+  }
+  DeferredResponse * deferred = _con->deferResponse(timeoutMs);
+  if (deferred != NULL) {
+    deferred->setStatusCode(_statusCode);
+    deferred->setStatusText(_statusText);
+    std::vector<HTTPHeader *> * headers = _headers.getAll();
+    for(std::vector<HTTPHeader*>::iterator h = headers->begin(); h != headers->end(); ++h) {
+      deferred->setHeader((*h)->_name, (*h)->_value);
+    }
+    _isDeferred = true;
+  }
+  return deferred;
+}
+
+/**
+ * Returns true if defer() has been called successfully
+ */
+bool HTTPResponse::isDeferred() {
+  return _isDeferred;
+}
+
 void HTTPResponse::printInternal(const std::string &str, bool skipBuffer) {
   writeBytesInternal((uint8_t*)str.c_str(), str.length(), skipBuffer);
 }
 
 size_t HTTPResponse::writeBytesInternal(const void * data, int length, bool skipBuffer) {
   if (!_isError) {
-    if (isResponseBuffered() && !skipBuffer) {
+    if (_isFixedLength && !skipBuffer) {
+      // Never send more than announced, as the rest would be taken as the next response
+      if (length >= 0 && (size_t)length > _contentLength - _contentWritten) {
+        _contentOverflow = true;
+        length = _contentLength - _contentWritten;
+      }
+      _contentWritten += length;
+      if (length == 0) {
+        return 0;
+      }
+    } else if (isResponseBuffered() && !skipBuffer) {
+      if (_isChunked) {
+        return writeChunked((byte*)data, length);
+      }
       // We are buffering ...
       if(length <= _responseCacheSize - _responseCachePointer) {
         // ... and there is space left in the buffer -> Write to buffer
-        size_t end = _responseCachePointer + length;
-        size_t i = 0;
-        while(_responseCachePointer < end) {
-          _responseCache[_responseCachePointer++] = ((byte*)data)[i++];
-        }
+        memcpy(_responseCache + HTTPS_CHUNK_PREFIX_SIZE + _responseCachePointer, data, length);
+        _responseCachePointer += length;
         // Returning skips the SSL_write below
         return length;
+      } else if (startChunkedEncoding()) {
+        // ... and the buffer is too small, but the client understands chunked encoding. The cache
+        // is sent as the first chunk and the connection can be kept alive
+        return writeChunked((byte*)data, length);
       } else {
         // .., and the buffer is too small. This is the point where we switch from
         // caching to streaming
@@ -158,22 +598,166 @@ size_t HTTPResponse::writeBytesInternal(const void * data, int length, bool skip
 
 void HTTPResponse::drainBuffer(bool onOverflow) {
   if (!_headerWritten) {
-    if (_responseCache != NULL && !onOverflow) {
+    // Responses to conditional requests have no body, a length would refer to the omitted content
+    if (_responseCache != NULL && !onOverflow && _statusCode != 204 && _statusCode != 304) {
       _headers.set(new HTTPHeader("Content-Length", intToString(_responseCachePointer)));
     }
-    printHeader();
+    if (_responseCache == NULL) {
+      printHeader();
+    }
   }
 
   if (_responseCache != NULL) {
     HTTPS_LOGD("Draining response buffer");
-    // Check for 0 as it may be an overflow reaction without any data that has been written earlier
-    if(_responseCachePointer > 0) {
-      // FIXME: Return value?
-      _con->writeBuffer((byte*)_responseCache, _responseCachePointer);
+    // FIXME: Return value?
+    writeCache(_responseCache + HTTPS_CHUNK_PREFIX_SIZE, _responseCachePointer);
+    releaseResponseCache();
+  }
+}
+
+/**
+ * Switches the response to Transfer-Encoding: chunked, if the connection allows it. The buffered
+ * data is kept and sent as part of the first chunk.
+ *
+ * Returns false if chunked encoding cannot be used.
+ */
+bool HTTPResponse::startChunkedEncoding() {
+  if (_isChunked) {
+    return true;
+  }
+  // If the handler has set a length itself, it must not be combined with chunked encoding
+  if (_headerWritten || !isResponseBuffered() || !_con->canUseChunkedEncoding() ||
+      !_headers.getView(HEADER_ID_CONTENT_LENGTH).empty()) {
+    return false;
+  }
+  HTTPS_LOGD("Switching to chunked encoding");
+  setHeader("Transfer-Encoding", "chunked");
+  setHeader("Connection", "keep-alive");
+  _isChunked = true;
+  return true;
+}
+
+/**
+ * Collects data in the cache and sends a chunk whenever the cache is full (or after each write, if
+ * the handler has requested chunked encoding)
+ */
+size_t HTTPResponse::writeChunked(const byte * data, size_t length) {
+  size_t written = 0;
+  while (written < length) {
+    size_t copyLength = std::min(length - written, _responseCacheSize - _responseCachePointer);
+    memcpy(_responseCache + HTTPS_CHUNK_PREFIX_SIZE + _responseCachePointer, data + written, copyLength);
+    _responseCachePointer += copyLength;
+    written += copyLength;
+    if (_responseCachePointer == _responseCacheSize) {
+      sendChunk(false);
     }
-    delete[] _responseCache;
-    _responseCache = NULL;
   }
+  if (_flushEachWrite && _responseCachePointer > 0) {
+    sendChunk(false);
+  }
+  return length;
+}
+
+/**
+ * Sends the data in the cache as a chunk. The chunk size and the line breaks are written into the
+ * space around the data, so that the chunk is sent with a single write.
+ *
+ * If last is set, the terminating zero-length chunk is appended.
+ */
+void HTTPResponse::sendChunk(bool last) {
+  byte * data = _responseCache + HTTPS_CHUNK_PREFIX_SIZE;
+  byte * start = data;
+  byte * end = data;
+  if (_responseCachePointer > 0) {
+    static const char hexDigits[] = "0123456789abcdef";
+    *(--start) = '\n';
+    *(--start) = '\r';
+    size_t remaining = _responseCachePointer;
+    do {
+      *(--start) = hexDigits[remaining & 0xf];
+      remaining >>= 4;
+    } while (remaining > 0);
+    end = data + _responseCachePointer;
+    *(end++) = '\r';
+    *(end++) = '\n';
+  }
+  if (last) {
+    memcpy(end, "0\r\n\r\n", 5);
+    end += 5;
+  }
+  writeCache(start, end - start);
+  _responseCachePointer = 0;
+}
+
+/**
+ * Decides whether the body is compressed, before length more bytes are written. The decision is
+ * postponed as long as the data fits into the buffer and is smaller than HTTPS_COMPRESSION_MIN_SIZE, so
+ * a body that ends before that is sent uncompressed. Only if there is no buffer, or if the handler has
+ * requested that each write is sent as a chunk, the length is open-ended and the body is compressed
+ * right away.
+ */
+void HTTPResponse::checkCompression(size_t length) {
+  size_t buffered = _responseCachePointer + length;
+  if (isResponseBuffered() && !_flushEachWrite && buffered < HTTPS_COMPRESSION_MIN_SIZE && buffered <= _responseCacheSize) {
+    return;
+  }
+  _compressionPending = false;
+  if (_headerWritten || _isFixedLength || !isCompressible()) {
+    return;
+  }
+
+  _encoder = new DeflateEncoder();
+  if (!_encoder->begin(_compressionFormat, _compressionWindowBits, _compressionMemLevel,
+      std::bind(&HTTPResponse::writeCompressed, this, std::placeholders::_1, std::placeholders::_2))) {
+    HTTPS_LOGW("Sending the response uncompressed");
+    delete _encoder;
+    _encoder = NULL;
+    return;
+  }
+  HTTPS_LOGD("Compressing the response");
+  setHeader("Content-Encoding", _compressionFormat == DEFLATE_GZIP ? "gzip" : "deflate");
+  setHeader("Vary", "Accept-Encoding");
+
+  // The data that has been buffered so far is smaller than HTTPS_COMPRESSION_MIN_SIZE. The encoder
+  // copies all of it before it produces any output, so the buffer can take the compressed data
+  if (_responseCachePointer > 0) {
+    size_t bufferedLength = _responseCachePointer;
+    _responseCachePointer = 0;
+    _encoder->write(_responseCache + HTTPS_CHUNK_PREFIX_SIZE, bufferedLength);
+  }
+}
+
+/**
+ * Returns false for responses that must not or need not be compressed
+ */
+bool HTTPResponse::isCompressible() {
+  if (_statusCode == 204 || _statusCode == 304 || isHeaderSet("Content-Encoding") || isHeaderSet("Content-Length")) {
+    return false;
+  }
+  // These formats are compressed already
+  static const char * compressedTypes[] = {
+    "image/png", "image/jpeg", "image/gif", "image/webp", "audio/", "video/", "font/woff",
+    "application/zip", "application/gzip", "application/x-gzip"
+  };
+  StringView contentType = _headers.getView(HEADER_ID_CONTENT_TYPE);
+  for (size_t i = 0; i < sizeof(compressedTypes) / sizeof(compressedTypes[0]); i++) {
+    size_t length = strlen(compressedTypes[i]);
+    if (contentType.substr(0, length).equalsIgnoreCase(StringView(compressedTypes[i], length))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Output function of the encoder. The compressed data is buffered, sent in chunks or streamed like
+ * any other body
+ */
+void HTTPResponse::writeCompressed(const uint8_t * data, size_t length) {
+  if (!isResponseBuffered()) {
+    printHeader();
+  }
+  writeBytesInternal(data, length);
 }
 
 } /* namespace httpsserver */
@@ -8,6 +8,7 @@
 #undef max
 #undef write
 #include <vector>
+#include <functional>
 
 #include <openssl/ssl.h>
 
@@ -16,6 +17,8 @@
 #include "ConnectionContext.hpp"
 #include "HTTPHeaders.hpp"
 #include "HTTPHeader.hpp"
+#include "DeflateEncoder.hpp"
+#include "DeferredResponse.hpp"
 
 namespace httpsserver {
 
@@ -32,6 +35,8 @@ public:
   uint16_t getStatusCode();
   std::string getStatusText();
   void setHeader(std::string const &name, std::string const &value);
+  void setDefaultHeaders(std::string const * defaultHeaders);
+  void setSerializedHeaders(const char * headers);
   bool isHeaderWritten();
 
   void printStd(std::string const &str);
@@ -39,30 +44,91 @@ public:
   // From Print:
   size_t write(const uint8_t *buffer, size_t size);
   size_t write(uint8_t);
+  int availableForWrite();
+  void onWritable(std::function<bool()> callback);
 
   void error();
 
   bool isResponseBuffered();
+  bool isKeepAlivePossible();
+  void setChunkedEncoding();
+  void setContentLength(size_t contentLength);
+  bool setCompression(StringView const &acceptEncoding, uint8_t windowBits = HTTPS_COMPRESSION_WINDOW_BITS,
+    uint8_t memLevel = HTTPS_COMPRESSION_MEM_LEVEL);
+  DeferredResponse * defer(unsigned long timeoutMs = HTTPS_DEFERRED_TIMEOUT);
+  bool isDeferred();
+  void detachResponseBuffer();
+  bool hasWritableCallback();
+  bool continueWriting();
   void finalize();
 
   ConnectionContext * _con;
   
 private:
   void printHeader();
+  std::string serializeHeader();
+  void serializeDefaultHeaders(std::string &out);
+  bool isHeaderSet(StringView const &name);
+  bool canWrite(size_t length);
+  void writeCache(byte * data, size_t length);
   void printInternal(const std::string &str, bool skipBuffer = false);
   size_t writeBytesInternal(const void * data, int length, bool skipBuffer = false);
   void drainBuffer(bool onOverflow = false);
+  void releaseResponseCache();
+  bool startChunkedEncoding();
+  size_t writeChunked(const byte * data, size_t length);
+  void sendChunk(bool last);
+  void checkCompression(size_t length);
+  bool isCompressible();
+  void writeCompressed(const uint8_t * data, size_t length);
 
   uint16_t _statusCode;
   std::string _statusText;
   HTTPHeaders _headers;
+  // Serialized headers of the server, added unless _headers contains a header with the same name
+  std::string const * _defaultHeaders;
+  // Headers of this response that are already serialized, or NULL
+  const char * _serializedHeaders;
   bool _headerWritten;
   bool _isError;
 
-  // Response cache
+  // Response cache. The data starts after HTTPS_CHUNK_PREFIX_SIZE bytes, so that the cache can be
+  // framed as a chunk in place
   byte * _responseCache;
   size_t _responseCacheSize;
   size_t _responseCachePointer;
+  // _responseCache has been allocated by detachResponseBuffer() instead of coming from the connection
+  bool _ownsResponseCache;
+
+  // Transfer-Encoding: chunked is used. Then, the cache is used to collect the next chunk
+  bool _isChunked;
+  // The handler requested chunked encoding, so every write is sent as a chunk right away
+  bool _flushEachWrite;
+
+  // The handler has set the length of the body in advance, which is then streamed without buffering
+  bool _isFixedLength;
+  size_t _contentLength;
+  size_t _contentWritten;
+  // The handler tried to write more than _contentLength bytes
+  bool _contentOverflow;
+
+  // setCompression() has been called, but it has not been decided yet whether the body is compressed
+  bool _compressionPending;
+  DeflateFormat _compressionFormat;
+  uint8_t _compressionWindowBits;
+  uint8_t _compressionMemLevel;
+  // Compresses the body, or NULL
+  DeflateEncoder * _encoder;
+
+  // The response is completed by another task, further writes to this object are discarded
+  bool _isDeferred;
+
+  // Continues the body after the handler has returned, see onWritable()
+  std::function<bool()> _writableCallback;
+  // The handler checks for space in the output queue, so write() refuses data instead of waiting
+  bool _nonBlocking;
+  // A write has been refused because the output queue was full, so data may be missing from the body
+  bool _writeRefused;
 };
 
 } /* namespace httpsserver */
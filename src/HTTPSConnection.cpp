@@ -6,6 +6,11 @@ namespace httpsserver {
 HTTPSConnection::HTTPSConnection(ResourceResolver * resResolver):
   HTTPConnection(resResolver) {
   _ssl = NULL;
+  _handshakeStartTS = 0;
+  _handshakeInProgress = false;
+  _handshakeWantsWrite = false;
+  _handshakeStats = NULL;
+  _pendingWriteLength = 0;
 }
 
 HTTPSConnection::~HTTPSConnection() {
@@ -13,6 +18,16 @@ HTTPSConnection::~HTTPSConnection() {
   closeConnection();
 }
 
+void HTTPSConnection::reset() {
+  HTTPConnection::reset();
+  _ssl = NULL;
+  _handshakeStartTS = 0;
+  _handshakeInProgress = false;
+  _handshakeWantsWrite = false;
+  _handshakeStats = NULL;
+  _pendingWriteLength = 0;
+}
+
 bool HTTPSConnection::isSecure() {
   return true;
 }
@@ -21,11 +36,14 @@ bool HTTPSConnection::isSecure() {
  * Initializes the connection from a server socket.
  *
  * The call WILL BLOCK if accept(serverSocketID) blocks. So use select() to check for that in advance.
+ *
+ * The TLS handshake is not performed here. The connection starts in STATE_HANDSHAKE and the handshake
+ * is advanced without blocking by subsequent calls to loop().
  */
-int HTTPSConnection::initialize(int serverSocketID, SSL_CTX * sslCtx, HTTPHeaders *defaultHeaders) {
+int HTTPSConnection::initialize(int serverSocketID, SSL_CTX * sslCtx, std::string const *defaultHeaders, HTTPSHandshakeStats *handshakeStats, ResponseBufferPool *responseBuffers) {
   if (_connectionState == STATE_UNDEFINED) {
     // Let the base class connect the plain tcp socket
-    int resSocket = HTTPConnection::initialize(serverSocketID, defaultHeaders);
+    int resSocket = HTTPConnection::initialize(serverSocketID, defaultHeaders, responseBuffers);
 
     // Build up SSL Connection context if the socket has been created successfully
     if (resSocket >= 0) {
@@ -37,13 +55,20 @@ int HTTPSConnection::initialize(int serverSocketID, SSL_CTX * sslCtx, HTTPHeader
         int success = SSL_set_fd(_ssl, resSocket);
         if (success) {
 
-          // Perform the handshake
-          success = SSL_accept(_ssl);
-          if (success) {
-            return resSocket;
-          } else {
-            HTTPS_LOGE("SSL_accept failed. Aborting handshake. FID=%d", resSocket);
-          }
+#ifdef SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER
+          // A write that could not be completed is repeated from the output queue of the connection
+          SSL_set_mode(_ssl, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#endif
+
+          // The handshake is performed in loop(). The socket is non-blocking, so that a slow client
+          // cannot stall the server
+          _handshakeStats = handshakeStats;
+          _handshakeStartTS = millis();
+          _handshakeInProgress = true;
+          _handshakeWantsWrite = false;
+          _connectionState = STATE_HANDSHAKE;
+          return resSocket;
+
         } else {
           HTTPS_LOGE("SSL_set_fd failed. Aborting handshake. FID=%d", resSocket);
         }
@@ -66,8 +91,52 @@ int HTTPSConnection::initialize(int serverSocketID, SSL_CTX * sslCtx, HTTPHeader
   return -1;
 }
 
+/**
+ * Performs the next step of the TLS handshake.
+ *
+ * SSL_accept() is called on the non-blocking socket and returns as soon as it would need to wait for
+ * the client. In that case, the connection waits for the socket to become readable or writable.
+ */
+void HTTPSConnection::continueHandshake() {
+  int res = SSL_accept(_ssl);
+  if (res == 1) {
+    _handshakeInProgress = false;
+    _handshakeWantsWrite = false;
+
+    unsigned long duration = millis() - _handshakeStartTS;
+    HTTPS_LOGI("Handshake finished after %lu ms. FID=%d", duration, getSocket());
+    if (_handshakeStats != NULL) {
+      // The statistics are shared by all connections, which may run in different worker tasks
+      __atomic_fetch_add(&_handshakeStats->count, 1, __ATOMIC_RELAXED);
+      __atomic_fetch_add(&_handshakeStats->totalMillis, duration, __ATOMIC_RELAXED);
+      unsigned long maxMillis = __atomic_load_n(&_handshakeStats->maxMillis, __ATOMIC_RELAXED);
+      while (duration > maxMillis &&
+        !__atomic_compare_exchange_n(&_handshakeStats->maxMillis, &maxMillis, duration, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    }
+
+    refreshTimeout();
+    _connectionState = STATE_INITIAL;
+  } else {
+    int err = SSL_get_error(_ssl, res);
+    if (err == SSL_ERROR_WANT_READ) {
+      _handshakeWantsWrite = false;
+    } else if (err == SSL_ERROR_WANT_WRITE) {
+      _handshakeWantsWrite = true;
+    } else {
+      HTTPS_LOGE("SSL_accept failed (error %d). Aborting handshake. FID=%d", err, getSocket());
+      _connectionState = STATE_ERROR;
+      closeConnection();
+    }
+  }
+}
+
+bool HTTPSConnection::waitsForWritable() {
+  return (_connectionState == STATE_HANDSHAKE && _handshakeWantsWrite) || HTTPConnection::waitsForWritable();
+}
 
 void HTTPSConnection::closeConnection() {
+  // Responses that are still collected have to be sent before the TLS session is shut down
+  flushOutput();
 
   // FIXME: Copy from HTTPConnection, could be done better probably
   if (_connectionState != STATE_ERROR && _connectionState != STATE_CLOSED) {
@@ -82,10 +151,33 @@ void HTTPSConnection::closeConnection() {
     _connectionState = STATE_CLOSING;
   }
 
+  // A connection that is closed before the handshake has been finished does not need a proper
+  // TLS shutdown, the session has never been established
+  if (_handshakeInProgress) {
+    _handshakeInProgress = false;
+    if (_handshakeStats != NULL) {
+      __atomic_fetch_add(&_handshakeStats->failed, 1, __ATOMIC_RELAXED);
+    }
+    if (_ssl) {
+      SSL_free(_ssl);
+      _ssl = NULL;
+    }
+  }
+
   // Try to tear down SSL while we are in the _shutdownTS timeout period or if an error occurred
   if (_ssl) {
-    if(_connectionState == STATE_ERROR || SSL_shutdown(_ssl) == 0) {
-      // SSL_shutdown will return 1 as soon as the client answered with close notify
+    // If the client has closed the connection already (e.g. after a keep-alive request), there is no
+    // close notify to wait for
+    int shutdownResult = 1;
+    if (_connectionState != STATE_ERROR && _clientState != CSTATE_CLOSED) {
+      shutdownResult = SSL_shutdown(_ssl);
+    }
+    // SSL_shutdown() returns 0 once our close notify has been sent, and is called again until it returns
+    // 1, which means that the client has answered with its own. Errors other than having to wait for the
+    // socket end the shutdown as well
+    int shutdownError = (shutdownResult < 0 ? SSL_get_error(_ssl, shutdownResult) : SSL_ERROR_NONE);
+    if (shutdownResult == 1 ||
+        (shutdownResult < 0 && shutdownError != SSL_ERROR_WANT_READ && shutdownError != SSL_ERROR_WANT_WRITE)) {
       // This means we are safe to close the socket
       SSL_free(_ssl);
       _ssl = NULL;
@@ -104,12 +196,50 @@ void HTTPSConnection::closeConnection() {
   }
 }
 
-size_t HTTPSConnection::writeBuffer(byte* buffer, size_t length) {
-  return SSL_write(_ssl, buffer, length);
+/**
+ * Writes data to the TLS session without blocking (see HTTPConnection::writeSocket()).
+ *
+ * If SSL_write() has to wait for the socket, it must be called again with the same data. The connection
+ * queues the data that has not been sent, so it is at the start of the buffer of the next call, and
+ * only the length has to be restored here.
+ */
+int HTTPSConnection::writeSocket(byte* buffer, size_t length) {
+  if (_ssl == NULL) {
+    return -1;
+  }
+  if (_pendingWriteLength > 0 && _pendingWriteLength <= length) {
+    length = _pendingWriteLength;
+  } else if (length > HTTPS_OUTPUT_QUEUE_SIZE) {
+    // A write that has to be repeated must fit into the output queue
+    length = HTTPS_OUTPUT_QUEUE_SIZE;
+  }
+  int res = SSL_write(_ssl, buffer, length);
+  if (res > 0) {
+    _pendingWriteLength = 0;
+    return res;
+  }
+  int err = SSL_get_error(_ssl, res);
+  if (err == SSL_ERROR_WANT_WRITE || err == SSL_ERROR_WANT_READ) {
+    _pendingWriteLength = length;
+    return 0;
+  }
+  HTTPS_LOGE("SSL_write failed (error %d). FID=%d", err, getSocket());
+  return -1;
 }
 
 size_t HTTPSConnection::readBytesToBuffer(byte* buffer, size_t length) {
-  return SSL_read(_ssl, buffer, length);
+  int res = SSL_read(_ssl, buffer, length);
+  if (res <= 0) {
+    // The socket is non-blocking, so SSL_read() may have to wait for the rest of a record
+    int err = SSL_get_error(_ssl, res);
+    if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+      errno = EWOULDBLOCK;
+      return -1;
+    } else if (res < 0) {
+      errno = ECONNRESET;
+    }
+  }
+  return res;
 }
 
 size_t HTTPSConnection::pendingByteCount() {
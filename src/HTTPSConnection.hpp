@@ -26,6 +26,19 @@
 
 namespace httpsserver {
 
+/**
+ * \brief Statistics about the TLS handshakes of an HTTPSServer
+ */
+struct HTTPSHandshakeStats {
+  // Number of completed handshakes
+  uint32_t count;
+  // Number of handshakes that failed or timed out
+  uint32_t failed;
+  // Sum and maximum of the durations of all completed handshakes (ms)
+  unsigned long totalMillis;
+  unsigned long maxMillis;
+};
+
 /**
  * \brief Connection class for an open TLS-enabled connection to an HTTPSServer
  */
@@ -34,9 +47,11 @@ public:
   HTTPSConnection(ResourceResolver * resResolver);
   virtual ~HTTPSConnection();
 
-  virtual int initialize(int serverSocketID, SSL_CTX * sslCtx, HTTPHeaders *defaultHeaders);
+  virtual int initialize(int serverSocketID, SSL_CTX * sslCtx, std::string const *defaultHeaders, HTTPSHandshakeStats *handshakeStats = NULL, ResponseBufferPool *responseBuffers = NULL);
+  virtual void reset();
   virtual void closeConnection();
   virtual bool isSecure();
+  virtual bool waitsForWritable();
 
 protected:
   friend class HTTPRequest;
@@ -45,12 +60,25 @@ protected:
   virtual size_t readBytesToBuffer(byte* buffer, size_t length);
   virtual size_t pendingByteCount();
   virtual bool canReadData();
-  virtual size_t writeBuffer(byte* buffer, size_t length);
+  virtual int writeSocket(byte* buffer, size_t length);
+  virtual void continueHandshake();
 
 private:
   // SSL context for this connection
   SSL * _ssl;
 
+  // Length of the last SSL_write() that could not be completed. It has to be repeated with the same data
+  size_t _pendingWriteLength;
+
+  // Timestamp of when the handshake was started
+  unsigned long _handshakeStartTS;
+  // True from accept() until the handshake has been finished
+  bool _handshakeInProgress;
+  // True if SSL_accept() needs to write data to continue the handshake
+  bool _handshakeWantsWrite;
+  // Statistics of the server, updated once the handshake has been finished (may be NULL)
+  HTTPSHandshakeStats * _handshakeStats;
+
 };
 
 } /* namespace httpsserver */
@@ -9,12 +9,21 @@ HTTPSServer::HTTPSServer(SSLCert * cert, const uint16_t port, const uint8_t maxC
 
   // Configure runtime data
   _sslctx = NULL;
+  memset(&_handshakeStats, 0, sizeof(_handshakeStats));
 }
 
 HTTPSServer::~HTTPSServer() {
 
 }
 
+/**
+ * Returns statistics about the TLS handshakes that the server has performed so far, like the number
+ * of handshakes and their average (totalMillis / count) and maximum duration.
+ */
+HTTPSHandshakeStats HTTPSServer::getHandshakeStats() {
+  return _handshakeStats;
+}
+
 /**
  * This method starts the server and begins to listen on the port
  */
@@ -55,9 +64,12 @@ void HTTPSServer::teardownSocket() {
 }
 
 int HTTPSServer::createConnection(int idx) {
-  HTTPSConnection * newConnection = new HTTPSConnection(this);
-  _connections[idx] = newConnection;
-  return newConnection->initialize(_socket, _sslctx, &_defaultHeaders);
+  HTTPSConnection * newConnection = static_cast<HTTPSConnection*>(allocateConnection(idx));
+  return newConnection->initialize(_socket, _sslctx, &_defaultHeaderBlock, &_handshakeStats, &_responseBuffers);
+}
+
+HTTPConnection * HTTPSServer::constructConnection() {
+  return new HTTPSConnection(this);
 }
 
 /**
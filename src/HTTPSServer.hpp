@@ -32,6 +32,8 @@ public:
   HTTPSServer(SSLCert * cert, const uint16_t portHTTPS = 443, const uint8_t maxConnections = 4, const in_addr_t bindAddress = 0);
   virtual ~HTTPSServer();
 
+  HTTPSHandshakeStats getHandshakeStats();
+
 private:
   // Static configuration. Port, keys, etc. ====================
   // Certificate that should be used (includes private key)
@@ -41,6 +43,9 @@ private:
   SSL_CTX * _sslctx;
   // Status of the server: Are we running, or not?
 
+  // Statistics about TLS handshakes, updated by the connections
+  HTTPSHandshakeStats _handshakeStats;
+
   // Setup functions
   virtual uint8_t setupSocket();
   virtual void teardownSocket();
@@ -49,6 +54,7 @@ private:
 
   // Helper functions
   virtual int createConnection(int idx);
+  virtual HTTPConnection * constructConnection();
 };
 
 } /* namespace httpsserver */
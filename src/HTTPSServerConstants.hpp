@@ -49,6 +49,11 @@
 #define HTTPS_REQUEST_MAX_HEADERS               20
 #endif
 
+// Number of hash table slots used to look up request headers that are not well-known (see HTTPHeaderId)
+#ifndef HTTPS_HEADER_HASH_SLOTS
+#define HTTPS_HEADER_HASH_SLOTS                 16
+#endif
+
 // Maximum length of the request line (GET /... HTTP/1.1)
 #ifndef HTTPS_REQUEST_MAX_REQUEST_LENGTH
 #define HTTPS_REQUEST_MAX_REQUEST_LENGTH       128
@@ -59,6 +64,12 @@
 #define HTTPS_REQUEST_MAX_HEADER_LENGTH        384
 #endif
 
+// Size (in bytes) of the per-connection memory that holds the request line and headers while a
+// request is handled. Headers that do not fit are stored on the heap instead
+#ifndef HTTPS_REQUEST_ARENA_SIZE
+#define HTTPS_REQUEST_ARENA_SIZE               1024
+#endif
+
 // Chunk size used for reading data from the ssl-enabled socket
 #ifndef HTTPS_CONNECTION_DATA_CHUNK_SIZE
 #define HTTPS_CONNECTION_DATA_CHUNK_SIZE       512
@@ -70,17 +81,137 @@
 #define HTTPS_KEEPALIVE_CACHESIZE              1400
 #endif
 
+// Space (in bytes) reserved in front of and behind the keep-alive cache for the framing of a chunk
+// when a response uses Transfer-Encoding: chunked ("<hex length>\r\n" and "\r\n0\r\n\r\n")
+#define HTTPS_CHUNK_PREFIX_SIZE                10
+#define HTTPS_CHUNK_SUFFIX_SIZE                7
+
+// Size (in bytes) of the pieces in which a StaticAssetNode sends files. The default fills a TCP segment
+// with one TLS record
+#ifndef HTTPS_STATIC_CHUNK_SIZE
+#define HTTPS_STATIC_CHUNK_SIZE                1400
+#endif
+
+// Default size of the window (as power of two, 9..15) and of the hash table (memory level, 1..9) used
+// to compress responses, see HTTPResponse::setCompression(). The defaults need about 10 KB per response
+#ifndef HTTPS_COMPRESSION_WINDOW_BITS
+#define HTTPS_COMPRESSION_WINDOW_BITS          11
+#endif
+#ifndef HTTPS_COMPRESSION_MEM_LEVEL
+#define HTTPS_COMPRESSION_MEM_LEVEL            3
+#endif
+
+// Responses with less data than this (in bytes) are not compressed. Must not exceed 1024
+#ifndef HTTPS_COMPRESSION_MIN_SIZE
+#define HTTPS_COMPRESSION_MIN_SIZE             256
+#endif
+#if HTTPS_COMPRESSION_MIN_SIZE > 1024
+#error "HTTPS_COMPRESSION_MIN_SIZE must not exceed 1024"
+#endif
+
+// Number of earlier positions that are checked when the compression searches a match. Higher values
+// compress better, but take more time
+#ifndef HTTPS_COMPRESSION_MAX_CHAIN
+#define HTTPS_COMPRESSION_MAX_CHAIN            16
+#endif
+
+// Size (in bytes) of the pieces in which compressed data is passed on to the response
+#ifndef HTTPS_COMPRESSION_OUTPUT_SIZE
+#define HTTPS_COMPRESSION_OUTPUT_SIZE          512
+#endif
+
+// Size (in bytes) of each buffer in the response buffer pool of the server
+#define HTTPS_RESPONSE_BUFFER_SIZE             (HTTPS_CHUNK_PREFIX_SIZE + HTTPS_KEEPALIVE_CACHESIZE + HTTPS_CHUNK_SUFFIX_SIZE)
+
 // Timeout for an HTTPS connection without any transmission
 #ifndef HTTPS_CONNECTION_TIMEOUT
 #define HTTPS_CONNECTION_TIMEOUT               20000
 #endif
 
+// Timeout (ms) for a keep-alive connection that waits for the next request. It is shorter than
+// HTTPS_CONNECTION_TIMEOUT, so idle clients do not occupy connection slots for long
+#ifndef HTTPS_KEEPALIVE_TIMEOUT
+#define HTTPS_KEEPALIVE_TIMEOUT                5000
+#endif
+
+// Default time (ms) that a connection waits for a deferred response (see HTTPResponse::defer()) to be
+// completed before the client receives a 503 response
+#ifndef HTTPS_DEFERRED_TIMEOUT
+#define HTTPS_DEFERRED_TIMEOUT                 10000
+#endif
+
+// Coroutine handlers (see HTTPCoroutine.hpp) are available if the compiler supports C++20 coroutines.
+// Define HTTPS_COROUTINES as 0 to leave them out anyway, which saves the arena of each connection
+#ifndef HTTPS_COROUTINES
+#if __cplusplus >= 202002L && defined(__has_include)
+#if __has_include(<coroutine>)
+#define HTTPS_COROUTINES                       1
+#endif
+#endif
+#endif
+#ifndef HTTPS_COROUTINES
+#define HTTPS_COROUTINES                       0
+#endif
+
+// Size (in bytes) of the arena of each connection, from which the frame of a coroutine handler and the
+// request and response it works on are allocated. Handlers whose frame does not fit are answered with
+// a 500 response. Only used if HTTPS_COROUTINES is enabled
+#ifndef HTTPS_COROUTINE_ARENA_SIZE
+#define HTTPS_COROUTINE_ARENA_SIZE             1536
+#endif
+
+// Maximum number of requests that are handled on a single connection before it is closed (0 = no limit)
+#ifndef HTTPS_KEEPALIVE_MAX_REQUESTS
+#define HTTPS_KEEPALIVE_MAX_REQUESTS           100
+#endif
+
+// Maximum number of steps of the state machine (reading the request line, the headers, calling the
+// handler, ...) that a connection may run in one pass of the server loop before the other connections
+// are served. A connection stops earlier if it has to wait for input
+#ifndef HTTPS_CONNECTION_STEP_BUDGET
+#define HTTPS_CONNECTION_STEP_BUDGET           32
+#endif
+
+// Maximum number of bytes that a connection may receive and process in one pass of the server loop
+// before the other connections are served. Bytes are counted when they are received and again when
+// they are processed. The step that exceeds the budget is completed
+#ifndef HTTPS_CONNECTION_BYTE_BUDGET
+#define HTTPS_CONNECTION_BYTE_BUDGET           (8 * HTTPS_CONNECTION_DATA_CHUNK_SIZE)
+#endif
+
+// Maximum number of pipelined requests (sent by the client without waiting for the responses) that
+// are answered in one pass of the server loop, before the other connections are served
+#ifndef HTTPS_PIPELINE_MAX_REQUESTS
+#define HTTPS_PIPELINE_MAX_REQUESTS            16
+#endif
+
+// Size (in bytes) of the output queue of a connection. Data that the socket does not accept right away
+// is queued and sent when the socket becomes writable, so a client that does not read cannot stall the
+// server. Once the queue is full, responses wait or refuse further data (see HTTPResponse::write()),
+// but a single write may exceed the size. The queue also collects the responses to pipelined requests, so
+// that they are sent with a single write. The memory is only allocated for connections that actually
+// use the queue
+#ifndef HTTPS_OUTPUT_QUEUE_SIZE
+#define HTTPS_OUTPUT_QUEUE_SIZE                2048
+#endif
+
+// Default number of messages that other tasks can queue for a websocket before the overflow policy
+// applies, see WebsocketHandler::createSendQueue()
+#ifndef HTTPS_WEBSOCKET_QUEUE_DEPTH
+#define HTTPS_WEBSOCKET_QUEUE_DEPTH            8
+#endif
+
 // Timeout used to wait for shutdown of SSL connection (ms)
 // (time for the client to return notify close flag) - without it, truncation attacks might be possible
 #ifndef HTTPS_SHUTDOWN_TIMEOUT
 #define HTTPS_SHUTDOWN_TIMEOUT                 5000
 #endif
 
+// Stack size (in bytes) of the worker tasks, see HTTPServer::setWorkerCount()
+#ifndef HTTPS_WORKER_STACK_SIZE
+#define HTTPS_WORKER_STACK_SIZE                8192
+#endif
+
 // Length of a SHA1 hash
 #ifndef HTTPS_SHA1_LENGTH
 #define HTTPS_SHA1_LENGTH                      20
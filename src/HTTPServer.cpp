@@ -15,6 +15,13 @@ HTTPServer::HTTPServer(const uint16_t port, const uint8_t maxConnections, const
   // Configure runtime data
   _socket = -1;
   _running = false;
+  _workerCount = 0;
+  _workers = NULL;
+  _connectionWorker = NULL;
+  _usePool = false;
+  _connectionPool = NULL;
+  _responseBufferCount = 0;
+  _wakeup = NULL;
 }
 
 HTTPServer::~HTTPServer() {
@@ -35,6 +42,26 @@ HTTPServer::~HTTPServer() {
 uint8_t HTTPServer::start() {
   if (!_running) {
     if (setupSocket()) {
+      _wakeup = new WakeupSocket();
+      // From now on, the default headers are part of the static default response
+      prerenderDefaultResponse(&_defaultHeaderBlock);
+      // Usually, each task that calls handlers needs only one buffer at a time
+      uint8_t bufferCount = _responseBufferCount;
+      if (bufferCount == 0) {
+        bufferCount = (_workerCount > 0 ? _workerCount : 1);
+      }
+      _responseBuffers.create(bufferCount, HTTPS_RESPONSE_BUFFER_SIZE);
+      if (_usePool) {
+        createConnectionPool();
+      }
+      if (_workerCount > 0 && !startWorkers()) {
+        deleteConnectionPool();
+        _responseBuffers.destroy();
+        teardownSocket();
+        _wakeup->release();
+        _wakeup = NULL;
+        return 0;
+      }
       _running = true;
       return 1;
     }
@@ -57,6 +84,11 @@ void HTTPServer::stop() {
     // Set the flag that the server is stopped
     _running = false;
 
+    // The workers close their connections and hand them back to us
+    if (_workerCount > 0) {
+      stopWorkers();
+    }
+
     // Clean up the connections
     bool hasOpenConnections = true;
     while(hasOpenConnections) {
@@ -68,8 +100,7 @@ void HTTPServer::stop() {
           // Check if closing succeeded. If not, we need to call the close function multiple times
           // and wait for the client
           if (_connections[i]->isClosed()) {
-            delete _connections[i];
-            _connections[i] = NULL;
+            freeConnection(i);
           } else {
             hasOpenConnections = true;
           }
@@ -78,9 +109,120 @@ void HTTPServer::stop() {
       delay(1);
     }
 
+    deleteConnectionPool();
+    _responseBuffers.destroy();
     teardownSocket();
+    // Tasks that complete a response of a closed connection may still signal the socket, so it is only
+    // closed once they are done
+    _wakeup->release();
+    _wakeup = NULL;
+
+  }
+}
+
+/**
+ * Enables or disables the connection pool. Has to be called before start().
+ *
+ * With the pool enabled, the server creates one connection object for each of the maxConnections slots
+ * when it is started, including their receive buffers and header storage. These objects are reset and
+ * reused for new clients instead of being allocated and deleted for each connection, which keeps the
+ * heap from fragmenting on long-running devices.
+ *
+ * Returns false if the server is already running.
+ */
+bool HTTPServer::setConnectionPooling(bool usePool) {
+  if (_running) {
+    return false;
+  }
+  _usePool = usePool;
+  return true;
+}
+
+void HTTPServer::createConnectionPool() {
+  _connectionPool = new HTTPConnection*[_maxConnections];
+  for (uint8_t i = 0; i < _maxConnections; i++) {
+    _connectionPool[i] = constructConnection();
+  }
+}
+
+void HTTPServer::deleteConnectionPool() {
+  if (_connectionPool != NULL) {
+    for (uint8_t i = 0; i < _maxConnections; i++) {
+      delete _connectionPool[i];
+    }
+    delete[] _connectionPool;
+    _connectionPool = NULL;
+  }
+}
 
+/**
+ * Sets the number of buffers that keep-alive responses use to store their content before it is sent.
+ * Has to be called before start().
+ *
+ * The buffers are allocated once when the server starts. If all of them are in use, further responses
+ * are streamed to the client and the connection is closed afterwards. With the default of 0, the server
+ * creates one buffer for each task that processes connections.
+ *
+ * Returns false if the server is already running.
+ */
+bool HTTPServer::setResponseBufferCount(uint8_t bufferCount) {
+  if (_running) {
+    return false;
   }
+  _responseBufferCount = bufferCount;
+  return true;
+}
+
+/**
+ * Sets the number of worker tasks that process the connections. Has to be called before start().
+ *
+ * With the default of 0, all connections are processed by the task that calls loop(). Otherwise, that
+ * task only accepts new connections and distributes them to the workers, which process them in
+ * parallel. Handlers and middleware functions are then called from the worker tasks.
+ *
+ * Returns false if the server is already running.
+ */
+bool HTTPServer::setWorkerCount(uint8_t workerCount) {
+  if (_running) {
+    return false;
+  }
+  _workerCount = workerCount;
+  return true;
+}
+
+bool HTTPServer::startWorkers() {
+  if (!_wakeup->open()) {
+    return false;
+  }
+  _connectionWorker = new uint8_t[_maxConnections];
+  _workers = new HTTPWorker*[_workerCount];
+  for (uint8_t w = 0; w < _workerCount; w++) {
+    _workers[w] = new HTTPWorker(_maxConnections, _wakeup);
+  }
+  for (uint8_t w = 0; w < _workerCount; w++) {
+    if (!_workers[w]->start()) {
+      HTTPS_LOGE("Could not start worker %d", w);
+      stopWorkers();
+      return false;
+    }
+  }
+  return true;
+}
+
+void HTTPServer::stopWorkers() {
+  for (uint8_t w = 0; w < _workerCount; w++) {
+    _workers[w]->stop();
+    // All connections of the worker are closed now
+    int idx;
+    while(_workers[w]->fetchReleasedConnection(idx)) {
+      freeConnection(idx);
+    }
+    delete _workers[w];
+  }
+  delete[] _workers;
+  _workers = NULL;
+  delete[] _connectionWorker;
+  _connectionWorker = NULL;
 }
 
 /**
@@ -90,78 +232,268 @@ void HTTPServer::stop() {
  */
 void HTTPServer::setDefaultHeader(std::string name, std::string value) {
   _defaultHeaders.set(new HTTPHeader(name, value));
+  _defaultHeaderBlock.clear();
+  _defaultHeaders.serialize(_defaultHeaderBlock);
 }
 
 /**
  * The loop method can either be called by periodical interrupt or in the main loop and handles processing
  * of data
+ *
+ * All sockets (the server socket and those of the open connections) are checked with a single call to
+ * select(), and only connections that have data available or work left to do are processed.
+ *
+ * This call returns immediately, use loop(maxWaitMs) to wait for the next event instead of busy polling.
  */
 void HTTPServer::loop() {
+  loop(0);
+}
+
+/**
+ * Like loop(), but waits up to maxWaitMs milliseconds for a socket event (new connection or incoming
+ * data) if there is nothing to do right now.
+ *
+ * The waiting time is also limited by the next connection timeout, so timeouts are handled on time.
+ * Running the server in a separate task, this avoids busy polling while the server is idle.
+ */
+void HTTPServer::loop(uint32_t maxWaitMs) {
 
   // Only handle requests if the server is still running
   if(!_running) return;
 
-  // Step 1: Process existing connections
-  // Process open connections and store the index of a free connection
-  // (we might use that later on)
+  if (_workerCount > 0) {
+    loopAcceptor(maxWaitMs);
+    return;
+  }
+
+  // Step 1: Clean up closed connections
+  // Store the index of a free connection (we might use that later on)
   int freeConnectionIdx = -1;
   for (int i = 0; i < _maxConnections; i++) {
-    // Fetch a free index in the pointer array
+    // if there is a connection (_connections[i]!=NULL), check if its open or closed:
+    if (_connections[i] != NULL && _connections[i]->isClosed()) {
+      // if it's closed, clean up:
+      freeConnection(i);
+    }
+
     if (_connections[i] == NULL) {
+      // Fetch a free index in the pointer array
       freeConnectionIdx = i;
+    }
+  }
 
-    } else {
-      // if there is a connection (_connections[i]!=NULL), check if its open or closed:
-      if (_connections[i]->isClosed()) {
-        // if it's closed, clean up:
-        delete _connections[i];
-        _connections[i] = NULL;
-        freeConnectionIdx = i;
-      } else {
-        // if not, process it:
-        _connections[i]->loop();
+  // Step 2: Wait for input and process the connections. The wakeup socket is signalled when a deferred
+  // response has been completed (it is only opened once that is used). Check for new connections only
+  // if there is space to store the connection
+  int sockets[2] = {_wakeup->getSocket(), _socket};
+  uint32_t readySockets = processConnections(_connections, _maxConnections, sockets, freeConnectionIdx > -1 ? 2 : 1, maxWaitMs);
+  if ((readySockets & 1) != 0) {
+    // The connection with the completed response has been processed already
+    _wakeup->clear();
+  }
+
+  // Step 3: Accept a new connection
+  if ((readySockets & 2) != 0) {
+    acceptConnection(freeConnectionIdx);
+  }
+}
+
+/**
+ * Loop of the task calling loop() if workers are used: Hands back closed connections, accepts new
+ * connections and assigns them to the worker with the least connections.
+ */
+void HTTPServer::loopAcceptor(uint32_t maxWaitMs) {
+  // Step 1: Take back the connections that have been closed by the workers
+  int freeConnectionIdx = -1;
+  for (int w = 0; w < _workerCount; w++) {
+    int idx;
+    while(_workers[w]->fetchReleasedConnection(idx)) {
+      freeConnection(idx);
+    }
+  }
+  for (int i = 0; i < _maxConnections; i++) {
+    if (_connections[i] == NULL) {
+      freeConnectionIdx = i;
+    }
+  }
+
+  // Step 2: Wait for a new connection or for a worker to release one
+  int sockets[2] = {_wakeup->getSocket(), _socket};
+  uint32_t readySockets = processConnections(NULL, 0, sockets, freeConnectionIdx > -1 ? 2 : 1, maxWaitMs);
+  if ((readySockets & 1) != 0) {
+    // Released connections will be handled in the next call
+    _wakeup->clear();
+  }
+
+  // Step 3: Accept the new connection and pass it on to a worker
+  if ((readySockets & 2) != 0 && acceptConnection(freeConnectionIdx)) {
+    uint8_t workerIdx = 0;
+    uint8_t workerLoad = 255;
+    for (uint8_t w = 0; w < _workerCount; w++) {
+      uint8_t load = 0;
+      for (int i = 0; i < _maxConnections; i++) {
+        if (_connections[i] != NULL && _connectionWorker[i] == w) {
+          load++;
+        }
       }
+      if (load < workerLoad) {
+        workerIdx = w;
+        workerLoad = load;
+      }
+    }
+    _connectionWorker[freeConnectionIdx] = workerIdx;
+    if (!_workers[workerIdx]->assignConnection(freeConnectionIdx, _connections[freeConnectionIdx])) {
+      HTTPS_LOGE("Could not assign connection to worker %d", workerIdx);
+      _connections[freeConnectionIdx]->closeConnection();
+      freeConnection(freeConnectionIdx);
     }
   }
- 
-  // Step 2: Check for new connections
-  // This makes only sense if there is space to store the connection
-  if (freeConnectionIdx > -1) {
+}
+
+/**
+ * Accepts a new connection into the given slot. Returns true on success.
+ */
+bool HTTPServer::acceptConnection(int idx) {
+  int socketIdentifier = createConnection(idx);
 
-    // We create a file descriptor set to be able to use the select function
-    fd_set sockfds;
-    // Out socket is the only socket in this set
-    FD_ZERO(&sockfds);
-    FD_SET(_socket, &sockfds);
+  // If initializing did not work, discard the new socket immediately
+  if (socketIdentifier < 0) {
+    freeConnection(idx);
+    return false;
+  }
+  // Workers replace this with their own wakeup socket when they adopt the connection
+  _connections[idx]->setWakeupSocket(_wakeup);
+  return true;
+}
 
-    // We define a "immediate" timeout
+/**
+ * Waits up to maxWaitMs milliseconds for an event on the sockets of the given connections or on one of
+ * the extra sockets, and then processes the connections that are readable or have pending work.
+ *
+ * Closed connections are skipped, the caller is responsible for cleaning them up. The return value has
+ * bit i set if extraSockets[i] is readable.
+ */
+uint32_t HTTPServer::processConnections(HTTPConnection ** connections, uint8_t count, const int * extraSockets, uint8_t extraCount, uint32_t maxWaitMs) {
+  // Step 1: Collect the sockets we need to watch
+  // We create a file descriptor set to be able to use the select function
+  fd_set sockfds;
+  FD_ZERO(&sockfds);
+  // Connections that wait for their socket to become writable (e.g. during the TLS handshake)
+  fd_set writefds;
+  FD_ZERO(&writefds);
+  int maxSocket = -1;
+
+  // Time to wait for socket events. We must not wait longer than up to the next timeout, and not at
+  // all if a connection can make progress without new data.
+  unsigned long waitMs = maxWaitMs;
+
+  for (int i = 0; i < count; i++) {
+    if (connections[i] != NULL && !connections[i]->isClosed()) {
+      int conSocket = connections[i]->getSocket();
+      if (conSocket >= 0) {
+        if (connections[i]->waitsForReadable()) {
+          FD_SET(conSocket, &sockfds);
+        }
+        if (connections[i]->waitsForWritable()) {
+          FD_SET(conSocket, &writefds);
+        }
+        if (conSocket > maxSocket) {
+          maxSocket = conSocket;
+        }
+      }
+      if (connections[i]->needsProcessing()) {
+        waitMs = 0;
+      } else if (waitMs > 0) {
+        unsigned long timeoutMs = connections[i]->millisUntilTimeout();
+        if (timeoutMs < waitMs) {
+          waitMs = timeoutMs;
+        }
+      }
+    }
+  }
+
+  for (int i = 0; i < extraCount; i++) {
+    if (extraSockets[i] >= 0) {
+      FD_SET(extraSockets[i], &sockfds);
+      if (extraSockets[i] > maxSocket) {
+        maxSocket = extraSockets[i];
+      }
+    }
+  }
+
+  // Step 2: Wait for input
+  if (maxSocket >= 0) {
     timeval timeout;
-    timeout.tv_sec  = 0;
-    timeout.tv_usec = 0; // Return immediately, if possible
+    timeout.tv_sec  = waitMs / 1000;
+    timeout.tv_usec = (waitMs % 1000) * 1000; // Return immediately, if waitMs is 0
 
-    // Wait for input
     // As by 2017-12-14, it seems that FD_SETSIZE is defined as 0x40, but socket IDs now
-    // start at 0x1000, so we need to use _socket+1 here
-    select(_socket + 1, &sockfds, NULL, NULL, &timeout);
-
-    // There is input
-    if (FD_ISSET(_socket, &sockfds)) {
-      int socketIdentifier = createConnection(freeConnectionIdx);
+    // start at 0x1000, so we need to use the highest socket ID + 1 here
+    if (select(maxSocket + 1, &sockfds, &writefds, NULL, &timeout) < 0) {
+      FD_ZERO(&sockfds);
+      FD_ZERO(&writefds);
+    }
+  } else if (waitMs > 0) {
+    // Nothing to watch (should not happen while the server socket is open)
+    delay(waitMs);
+  }
 
-      // If initializing did not work, discard the new socket immediately
-      if (socketIdentifier < 0) {
-        delete _connections[freeConnectionIdx];
-        _connections[freeConnectionIdx] = NULL;
+  // Step 3: Process existing connections that are readable or have pending work
+  for (int i = 0; i < count; i++) {
+    if (connections[i] != NULL && !connections[i]->isClosed()) {
+      int conSocket = connections[i]->getSocket();
+      if (conSocket >= 0 && FD_ISSET(conSocket, &sockfds)) {
+        connections[i]->signalSocketReadable();
+        connections[i]->loop();
+      } else if ((conSocket >= 0 && FD_ISSET(conSocket, &writefds)) || connections[i]->needsProcessing()) {
+        connections[i]->loop();
       }
     }
+  }
 
+  uint32_t readySockets = 0;
+  for (int i = 0; i < extraCount; i++) {
+    if (extraSockets[i] >= 0 && FD_ISSET(extraSockets[i], &sockfds)) {
+      readySockets |= (1 << i);
+    }
   }
+  return readySockets;
 }
 
 int HTTPServer::createConnection(int idx) {
-  HTTPConnection * newConnection = new HTTPConnection(this);
-  _connections[idx] = newConnection;
-  return newConnection->initialize(_socket, &_defaultHeaders);
+  HTTPConnection * newConnection = allocateConnection(idx);
+  return newConnection->initialize(_socket, &_defaultHeaderBlock, &_responseBuffers);
+}
+
+/**
+ * Creates a new connection object. Overridden by servers that use a different connection class.
+ */
+HTTPConnection * HTTPServer::constructConnection() {
+  return new HTTPConnection(this);
+}
+
+/**
+ * Provides the connection object for the given slot, either by taking it from the pool or by creating
+ * a new one.
+ */
+HTTPConnection * HTTPServer::allocateConnection(int idx) {
+  if (_connectionPool != NULL) {
+    _connections[idx] = _connectionPool[idx];
+    _connections[idx]->reset();
+  } else {
+    _connections[idx] = constructConnection();
+  }
+  return _connections[idx];
+}
+
+/**
+ * Releases the (closed) connection in the given slot. Pooled connections are kept for reuse.
+ */
+void HTTPServer::freeConnection(int idx) {
+  if (_connectionPool == NULL) {
+    delete _connections[idx];
+  }
+  _connections[idx] = NULL;
 }
 
 /**
@@ -21,6 +21,9 @@
 #include "ResourceResolver.hpp"
 #include "ResolvedResource.hpp"
 #include "HTTPConnection.hpp"
+#include "HTTPWorker.hpp"
+#include "WakeupSocket.hpp"
+#include "ResponseBufferPool.hpp"
 
 namespace httpsserver {
 
@@ -37,10 +40,17 @@ public:
   bool isRunning();
 
   void loop();
+  void loop(uint32_t maxWaitMs);
 
   void setDefaultHeader(std::string name, std::string value);
 
+  bool setWorkerCount(uint8_t workerCount);
+  bool setConnectionPooling(bool usePool);
+  bool setResponseBufferCount(uint8_t bufferCount);
+
 protected:
+  friend class HTTPWorker;
+
   // Static configuration. Port, keys, etc. ====================
   // Certificate that should be used (includes private key)
   const uint16_t _port;
@@ -62,6 +72,25 @@ protected:
   sockaddr_in _sock_addr;
   // Headers that are included in every response
   HTTPHeaders _defaultHeaders;
+  // The same headers, serialized like "Name: value\r\n", so they can be copied into each response
+  std::string _defaultHeaderBlock;
+
+  // Worker tasks processing the connections (only used if _workerCount > 0)
+  uint8_t _workerCount;
+  HTTPWorker ** _workers;
+  // Index of the worker that owns each connection slot
+  uint8_t * _connectionWorker;
+  // Signalled by the workers when they release a connection, or (without workers) when a deferred
+  // response has been completed. Created when the server starts
+  WakeupSocket * _wakeup;
+
+  // Preallocated connection objects, one for each slot (only used if _usePool is set)
+  bool _usePool;
+  HTTPConnection ** _connectionPool;
+
+  // Buffers that are used by keep-alive responses (0 = one for each task that processes connections)
+  uint8_t _responseBufferCount;
+  ResponseBufferPool _responseBuffers;
 
   // Setup functions
   virtual uint8_t setupSocket();
@@ -69,6 +98,16 @@ protected:
 
   // Helper functions
   virtual int createConnection(int idx);
+  virtual HTTPConnection * constructConnection();
+  HTTPConnection * allocateConnection(int idx);
+  void freeConnection(int idx);
+  void createConnectionPool();
+  void deleteConnectionPool();
+  bool acceptConnection(int idx);
+  void loopAcceptor(uint32_t maxWaitMs);
+  bool startWorkers();
+  void stopWorkers();
+  static uint32_t processConnections(HTTPConnection ** connections, uint8_t count, const int * extraSockets, uint8_t extraCount, uint32_t maxWaitMs);
 };
 
 }
@@ -0,0 +1,170 @@
+#include "HTTPWorker.hpp"
+#include "HTTPServer.hpp"
+
+namespace httpsserver {
+
+HTTPWorker::HTTPWorker(uint8_t maxConnections, WakeupSocket * serverWakeup):
+  _maxConnections(maxConnections),
+  _assigned(maxConnections),
+  _released(maxConnections),
+  _serverWakeup(serverWakeup) {
+
+  _connections = new HTTPConnection*[maxConnections];
+  _connectionIdx = new int[maxConnections];
+  for(uint8_t i = 0; i < maxConnections; i++) {
+    _connections[i] = NULL;
+    _connectionIdx[i] = -1;
+  }
+  _running = false;
+  _wakeup = new WakeupSocket();
+}
+
+HTTPWorker::~HTTPWorker() {
+  stop();
+  delete[] _connections;
+  delete[] _connectionIdx;
+  _wakeup->release();
+}
+
+/**
+ * Starts the worker task. Returns true on success.
+ */
+bool HTTPWorker::start() {
+  if (_running) {
+    return true;
+  }
+  if (!_wakeup->open()) {
+    return false;
+  }
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, HTTPS_WORKER_STACK_SIZE);
+  _running = true;
+  int res = pthread_create(&_thread, &attr, &HTTPWorker::run, this);
+  pthread_attr_destroy(&attr);
+  if (res != 0) {
+    HTTPS_LOGE("Could not create worker task (%d)", res);
+    _running = false;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Stops the worker task. Waits until all connections of the worker have been closed and released.
+ */
+void HTTPWorker::stop() {
+  if (_running) {
+    _running = false;
+    _wakeup->signal();
+    pthread_join(_thread, NULL);
+  }
+}
+
+/**
+ * Hands an initialized connection over to the worker. Called by the server.
+ *
+ * Returns false if the connection could not be assigned, the server keeps ownership in that case.
+ */
+bool HTTPWorker::assignConnection(int idx, HTTPConnection * connection) {
+  if (!_running) {
+    return false;
+  }
+  Assignment assignment;
+  assignment.idx = idx;
+  assignment.connection = connection;
+  if (!_assigned.push(assignment)) {
+    return false;
+  }
+  _wakeup->signal();
+  return true;
+}
+
+/**
+ * Returns the slot index of a connection that has been closed by the worker. Called by the server,
+ * which takes back ownership of the connection.
+ */
+bool HTTPWorker::fetchReleasedConnection(int &idx) {
+  return _released.pop(idx);
+}
+
+void * HTTPWorker::run(void * param) {
+  HTTPWorker * worker = (HTTPWorker*)param;
+  while(worker->_running) {
+    worker->loop(1000);
+  }
+  worker->closeConnections();
+  return NULL;
+}
+
+void HTTPWorker::loop(uint32_t maxWaitMs) {
+  adoptConnections();
+  releaseClosedConnections();
+
+  int wakeupSocket = _wakeup->getSocket();
+  if (HTTPServer::processConnections(_connections, _maxConnections, &wakeupSocket, 1, maxWaitMs) & 1) {
+    // New connections will be adopted in the next call
+    _wakeup->clear();
+  }
+}
+
+/**
+ * Moves newly assigned connections from the hand-off queue to the worker's connection slots
+ */
+void HTTPWorker::adoptConnections() {
+  for (uint8_t i = 0; i < _maxConnections; i++) {
+    if (_connections[i] == NULL) {
+      Assignment assignment;
+      if (!_assigned.pop(assignment)) {
+        return;
+      }
+      _connections[i] = assignment.connection;
+      _connectionIdx[i] = assignment.idx;
+      _connections[i]->setWakeupSocket(_wakeup);
+    }
+  }
+}
+
+/**
+ * Hands closed connections back to the server
+ */
+void HTTPWorker::releaseClosedConnections() {
+  bool released = false;
+  for (uint8_t i = 0; i < _maxConnections; i++) {
+    if (_connections[i] != NULL && _connections[i]->isClosed()) {
+      // The queue has room for all connections of the server, so this cannot fail
+      _released.push(_connectionIdx[i]);
+      _connections[i] = NULL;
+      _connectionIdx[i] = -1;
+      released = true;
+    }
+  }
+  if (released) {
+    _serverWakeup->signal();
+  }
+}
+
+/**
+ * Closes all connections of the worker and hands them back to the server. Called when the worker stops.
+ */
+void HTTPWorker::closeConnections() {
+  bool hasOpenConnections = true;
+  while(hasOpenConnections) {
+    adoptConnections();
+    hasOpenConnections = false;
+    for (uint8_t i = 0; i < _maxConnections; i++) {
+      if (_connections[i] != NULL) {
+        _connections[i]->closeConnection();
+        // If closing did not succeed yet, we need to call the close function again and wait for the client
+        hasOpenConnections |= !_connections[i]->isClosed();
+      }
+    }
+    releaseClosedConnections();
+    if (hasOpenConnections) {
+      delay(1);
+    }
+  }
+}
+
+} /* namespace httpsserver */
@@ -0,0 +1,69 @@
+#ifndef SRC_HTTPWORKER_HPP_
+#define SRC_HTTPWORKER_HPP_
+
+#include <Arduino.h>
+#include <pthread.h>
+#include <atomic>
+
+#include "HTTPSServerConstants.hpp"
+#include "HTTPConnection.hpp"
+#include "LockFreeQueue.hpp"
+#include "WakeupSocket.hpp"
+
+namespace httpsserver {
+
+/**
+ * \brief Task that processes a share of the connections of an HTTPServer
+ *
+ * Workers are used if the number of workers has been set with HTTPServer::setWorkerCount(). The task
+ * calling HTTPServer::loop() then only accepts new connections and assigns each of them to one of the
+ * workers. From then on, the connection is owned and processed exclusively by that worker, until the
+ * worker hands it back to the server once it has been closed.
+ */
+class HTTPWorker {
+public:
+  HTTPWorker(uint8_t maxConnections, WakeupSocket * serverWakeup);
+  virtual ~HTTPWorker();
+
+  bool start();
+  void stop();
+
+  bool assignConnection(int idx, HTTPConnection * connection);
+  bool fetchReleasedConnection(int &idx);
+
+private:
+  // Entry of the hand-off queue from the server to the worker
+  struct Assignment {
+    int idx;
+    HTTPConnection * connection;
+  };
+
+  static void * run(void * worker);
+  void loop(uint32_t maxWaitMs);
+  void adoptConnections();
+  void releaseClosedConnections();
+  void closeConnections();
+
+  const uint8_t _maxConnections;
+
+  // Connections owned by this worker, and the index of their slot in the server's connection array
+  HTTPConnection ** _connections;
+  int * _connectionIdx;
+
+  // Lock-free hand-off of new connections to the worker and of closed connections back to the server
+  LockFreeQueue<Assignment> _assigned;
+  LockFreeQueue<int> _released;
+
+  // Used to wake up the worker when a new connection is assigned to it, when a deferred response of one
+  // of its connections has been completed or when it should stop
+  WakeupSocket * _wakeup;
+  // Used to notify the server about released connections
+  WakeupSocket * _serverWakeup;
+
+  std::atomic<bool> _running;
+  pthread_t _thread;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_HTTPWORKER_HPP_ */
@@ -0,0 +1,105 @@
+#ifndef SRC_LOCKFREEQUEUE_HPP_
+#define SRC_LOCKFREEQUEUE_HPP_
+
+#include <stddef.h>
+#include <atomic>
+
+namespace httpsserver {
+
+/**
+ * \brief Bounded lock-free queue that can be used to pass items between tasks
+ *
+ * Any number of tasks may push and pop concurrently. Neither operation blocks or allocates memory;
+ * push() returns false if the queue is full and pop() returns false if it is empty. The storage is
+ * allocated once in the constructor, the capacity is rounded up to the next power of two.
+ *
+ * (Implementation based on Dmitry Vyukov's bounded MPMC queue)
+ */
+template<typename T>
+class LockFreeQueue {
+public:
+  LockFreeQueue(size_t capacity) {
+    size_t size = 1;
+    while(size < capacity) size <<= 1;
+    _mask = size - 1;
+    _cells = new Cell[size];
+    for(size_t i = 0; i < size; i++) {
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    _enqueuePos.store(0, std::memory_order_relaxed);
+    _dequeuePos.store(0, std::memory_order_relaxed);
+  }
+
+  virtual ~LockFreeQueue() {
+    delete[] _cells;
+  }
+
+  size_t capacity() {
+    return _mask + 1;
+  }
+
+  /**
+   * Appends an item to the queue. Returns false if the queue is full.
+   */
+  bool push(T const &item) {
+    Cell * cell;
+    size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+    while(true) {
+      cell = &_cells[pos & _mask];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = _enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = item;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Removes the oldest item from the queue. Returns false if the queue is empty.
+   */
+  bool pop(T &item) {
+    Cell * cell;
+    size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+    while(true) {
+      cell = &_cells[pos & _mask];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+      if (diff == 0) {
+        if (_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = _dequeuePos.load(std::memory_order_relaxed);
+      }
+    }
+    item = cell->data;
+    cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  Cell * _cells;
+  size_t _mask;
+  std::atomic<size_t> _enqueuePos;
+  std::atomic<size_t> _dequeuePos;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_LOCKFREEQUEUE_HPP_ */
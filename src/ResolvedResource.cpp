@@ -4,14 +4,10 @@ namespace httpsserver {
 
 ResolvedResource::ResolvedResource() {
   _matchingNode = NULL;
-  _params = NULL;
 }
 
 ResolvedResource::~ResolvedResource() {
-  // Delete only params, nodes are reused/server-internal
-  if (_params != NULL) {
-    delete _params;
-  }
+
 }
 
 bool ResolvedResource::didMatch() {
@@ -27,14 +23,7 @@ void ResolvedResource::setMatchingNode(HTTPNode * node) {
 }
 
 ResourceParameters * ResolvedResource::getParams() {
-  return _params;
-}
-
-void ResolvedResource::setParams(ResourceParameters * params) {
-  if (_params != NULL && _params!=params) {
-    delete _params;
-  }
-  _params = params;
+  return &_params;
 }
 
 } /* namespace httpsserver */
@@ -18,11 +18,10 @@ public:
   HTTPNode * getMatchingNode();
   bool didMatch();
   ResourceParameters * getParams();
-  void setParams(ResourceParameters * params);
 
 private:
   HTTPNode * _matchingNode;
-  ResourceParameters * _params;
+  ResourceParameters _params;
 };
 
 } /* namespace httpsserver */
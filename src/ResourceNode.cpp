@@ -6,8 +6,20 @@ ResourceNode::ResourceNode(const std::string &path, const std::string &method, c
   HTTPNode(path, HANDLER_CALLBACK, tag),
   _method(method),
   _callback(callback) {
+#if HTTPS_COROUTINES
+  _coroutine = NULL;
+#endif
+}
+
+#if HTTPS_COROUTINES
+ResourceNode::ResourceNode(const std::string &path, const std::string &method, const HTTPSCoroutineFunction * coroutine, const std::string &tag):
+  HTTPNode(path, HANDLER_CALLBACK, tag),
+  _method(method),
+  _callback(NULL),
+  _coroutine(coroutine) {
 
 }
+#endif
 
 ResourceNode::~ResourceNode() {
   
@@ -5,6 +5,7 @@
 
 #include "HTTPNode.hpp"
 #include "HTTPSCallbackFunction.hpp"
+#include "HTTPCoroutine.hpp"
 
 namespace httpsserver {
 
@@ -16,10 +17,17 @@ namespace httpsserver {
 class ResourceNode : public HTTPNode {
 public:
   ResourceNode(const std::string &path, const std::string &method, const HTTPSCallbackFunction * callback, const std::string &tag = "");
+#if HTTPS_COROUTINES
+  ResourceNode(const std::string &path, const std::string &method, const HTTPSCoroutineFunction * coroutine, const std::string &tag = "");
+#endif
   virtual ~ResourceNode();
 
   const std::string _method;
   const HTTPSCallbackFunction * _callback;
+#if HTTPS_COROUTINES
+  // Set instead of _callback if the handler is a coroutine
+  const HTTPSCoroutineFunction * _coroutine;
+#endif
   std::string getMethod() { return _method; }
 };
 
@@ -16,31 +16,36 @@ ResourceResolver::~ResourceResolver() {
  */
 void ResourceResolver::registerNode(HTTPNode *node) {
   _nodes->push_back(node);
+  _routes.insert(node);
 }
 
 /**
  * This method can be used to deactivate a HTTPSNode that has been registered previously
  */
 void ResourceResolver::unregisterNode(HTTPNode *node) {
-
+  std::vector<HTTPNode*>::iterator pos = std::find(_nodes->begin(), _nodes->end(), node);
+  if (pos != _nodes->end()) {
+    _nodes->erase(pos);
+    // Rebuild the tree, so that the remaining nodes keep their order
+    _routes.clear();
+    for(std::vector<HTTPNode*>::iterator itNode = _nodes->begin(); itNode != _nodes->end(); ++itNode) {
+      _routes.insert(*itNode);
+    }
+  }
 }
 
 void ResourceResolver::resolveNode(const std::string &method, const std::string &url, ResolvedResource &resolvedResource, HTTPNodeType nodeType) {
   // Reset the resource
   resolvedResource.setMatchingNode(NULL);
-  resolvedResource.setParams(NULL);
 
   // Memory management of this object will be performed by the ResolvedResource instance
-  ResourceParameters * params = new ResourceParameters();
+  ResourceParameters * params = resolvedResource.getParams();
 
   // Split URL in resource name and request params. Request params start after an optional '?'
   size_t reqparamIdx = url.find('?');
   // Store this index to stop path parsing there
   size_t pathEnd = reqparamIdx != std::string::npos ? reqparamIdx : url.size();
 
-  // If no '?' is contained in url, 0:npos will return the string as it is
-  std::string resourceName = url.substr(0, reqparamIdx);
-
   // Set request params in params object if a '?' exists
   if (reqparamIdx != std::string::npos) {
     do {
@@ -76,88 +81,37 @@ void ResourceResolver::resolveNode(const std::string &method, const std::string
     } while(reqparamIdx != std::string::npos);
   }
 
-
   // Check whether a resource matches
-
-  for(std::vector<HTTPNode*>::iterator itNode = _nodes->begin(); itNode != _nodes->end(); ++itNode) {
-    params->resetPathParameters();
-    HTTPNode *node = *itNode;
-    if (node->_nodeType==nodeType) {
-      if (
-        // For handler functions, check the method declared with the node
-        (node->_nodeType==HANDLER_CALLBACK && ((ResourceNode*)node)->_method == method) ||
-        // For websockets, the specification says that GET is the only choice
-        (node->_nodeType==WEBSOCKET && method=="GET")
-      ) {
-        HTTPS_LOGD("Testing route %s", node->_path.c_str());
-        bool match = true;
-        size_t paramCount = node->getPathParamCount();
-        // indices in input and pattern
-        size_t inputIdx = 0, pathIdx = 0;
-        HTTPS_LOGD("(INIT) inputIdx: %d, pathIdx: %d, pathEnd: %d, path: %s, url: %s",
-          inputIdx, pathIdx, pathEnd, node->_path.c_str(), url.c_str());
-
-        for (size_t paramIdx = 0; match && paramIdx < paramCount; paramIdx += 1) {
-          HTTPS_LOGD("(LOOP) inputIdx: %d, pathIdx: %d, pathEnd: %d, path: %s, url: %s",
-            inputIdx, pathIdx, pathEnd, node->_path.c_str(), url.c_str());
-          // Test static path before the parameter
-          size_t paramPos = node->getParamIdx(paramIdx);
-          size_t staticLength = paramPos - pathIdx;
-          match &= url.substr(inputIdx, staticLength) == node->_path.substr(pathIdx, staticLength);
-          inputIdx += staticLength;
-          pathIdx += staticLength;
-
-          // Extract parameter value
-          if (match) {
-            size_t paramEnd = url.find('/', inputIdx);
-            if (paramEnd == std::string::npos && inputIdx <= pathEnd) {
-              // Consume the remaining input (might be "" for the last param)
-              paramEnd = pathEnd;
-            }
-            if (paramEnd != std::string::npos) {
-              size_t paramLength = paramEnd - inputIdx;
-              params->setPathParameter(paramIdx, urlDecode(url.substr(inputIdx, paramLength)));
-              pathIdx += 1;
-              inputIdx += paramLength;
-            } else {
-              match = false;
-              HTTPS_LOGD("(LOOP) No match on param part");
-            }
-          } else {
-            HTTPS_LOGD("(LOOP) No match on static part");
-          }
-        }
-        HTTPS_LOGD("(STTC) inputIdx: %d, pathIdx: %d, pathEnd: %d, path: %s, url: %s",
-          inputIdx, pathIdx, pathEnd, node->_path.c_str(), url.c_str());
-        // Test static path after the parameter (up to pathEnd)
-        if (match) {
-          match = url.substr(inputIdx, pathEnd - inputIdx)==node->_path.substr(pathIdx);
+  StringView path(url.data(), pathEnd);
+  HTTPNode * node = _routes.match(method, path, nodeType);
+
+  if (node != NULL) {
+    HTTPS_LOGD("Matched route %s", node->_path.c_str());
+    resolvedResource.setMatchingNode(node);
+
+    // Only the parameters of the matching node are extracted. The segments of path and pattern are
+    // aligned, so the parameter values are the segments of the path at the positions of the asterisks
+    if (node->hasPathParameter()) {
+      StringView pattern(node->_path);
+      size_t patternStart = 0;
+      size_t pathStart = 0;
+      size_t paramIdx = 0;
+      while(patternStart != StringView::npos && pathStart != StringView::npos) {
+        size_t patternNext = RouteTrie::nextSegment(pattern, patternStart);
+        size_t pathNext = RouteTrie::nextSegment(path, pathStart);
+        if (patternStart > 0 && RouteTrie::getSegment(pattern, patternStart, patternNext).equals("*")) {
+          params->setPathParameter(paramIdx++, urlDecode(RouteTrie::getSegment(path, pathStart, pathNext).toString()));
         }
-        HTTPS_LOGD("(END ) inputIdx: %d, pathIdx: %d, pathEnd: %d, path: %s, url: %s",
-          inputIdx, pathIdx, pathEnd, node->_path.c_str(), url.c_str());
-
-        if (match) {
-          resolvedResource.setMatchingNode(node);
-          HTTPS_LOGD("It's a match!");
-          break;
-        }
-      } // method check
-    } // node type check
-  } // resource node for loop
+        patternStart = patternNext;
+        pathStart = pathNext;
+      }
+    }
+  }
 
   // If the resource did not match, configure the default resource
   if (!resolvedResource.didMatch() && _defaultNode != NULL) {
-    params->resetPathParameters();
     resolvedResource.setMatchingNode(_defaultNode);
   }
-
-  // If resolving did work, set the params, otherwise delete them
-  if (resolvedResource.didMatch()) {
-    // The resolvedResource now takes care of memory management for the params
-    resolvedResource.setParams(params);
-  } else {
-    delete params;
-  }
 }
 
 void ResourceResolver::addMiddleware(const HTTPSMiddlewareFunction * mwFunction) {
@@ -176,4 +130,51 @@ void ResourceResolver::setDefaultNode(HTTPNode * defaultNode) {
   _defaultNode = defaultNode;
 }
 
+/**
+ * Sets a static response that is sent if no node matches the request and no default node is set.
+ *
+ * The response is rendered in advance and sent with a single write, without calling a handler or the
+ * middleware. The connection is closed afterwards. Default headers of the server are included if this
+ * is called before the server is started.
+ */
+void ResourceResolver::setDefaultResponse(uint16_t statusCode, std::string const &statusText, std::string const &contentType, std::string const &body) {
+  _defaultResponse.statusCode = statusCode;
+  _defaultResponse.statusText = statusText;
+  _defaultResponse.contentType = contentType;
+  _defaultResponse.body = body;
+  prerenderDefaultResponse(NULL);
+}
+
+/**
+ * Returns the serialized default response, or an empty string if none is set
+ */
+const std::string & ResourceResolver::getDefaultResponse() {
+  return _defaultResponse.rendered;
+}
+
+/**
+ * Serializes the default response (if one is set), including the given serialized default headers
+ */
+void ResourceResolver::prerenderDefaultResponse(std::string const * defaultHeaders) {
+  std::string &r = _defaultResponse.rendered;
+  r.clear();
+  if (_defaultResponse.statusCode == 0) {
+    return;
+  }
+  r += "HTTP/1.1 ";
+  r += intToString(_defaultResponse.statusCode);
+  r += ' ';
+  r += _defaultResponse.statusText;
+  r += "\r\n";
+  if (defaultHeaders != NULL) {
+    r += *defaultHeaders;
+  }
+  r += "Connection: close\r\nContent-Type: ";
+  r += _defaultResponse.contentType;
+  r += "\r\nContent-Length: ";
+  r += intToString(_defaultResponse.body.length());
+  r += "\r\n\r\n";
+  r += _defaultResponse.body;
+}
+
 }
@@ -9,9 +9,13 @@
 #include <algorithm>
 
 #include "HTTPNode.hpp"
+#include "HTTPHeaders.hpp"
 #include "WebsocketNode.hpp"
 #include "ResourceNode.hpp"
 #include "ResolvedResource.hpp"
+#include "RouteTrie.hpp"
+#include "StringView.hpp"
+#include "util.hpp"
 #include "HTTPMiddlewareFunction.hpp"
 
 namespace httpsserver {
@@ -27,6 +31,9 @@ public:
   void registerNode(HTTPNode *node);
   void unregisterNode(HTTPNode *node);
   void setDefaultNode(HTTPNode *node);
+  void setDefaultResponse(uint16_t statusCode, std::string const &statusText, std::string const &contentType, std::string const &body);
+  const std::string & getDefaultResponse();
+  void prerenderDefaultResponse(std::string const * defaultHeaders);
   void resolveNode(const std::string &method, const std::string &url, ResolvedResource &resolvedResource, HTTPNodeType nodeType);
 
   /** Add a middleware function to the end of the middleware function chain. See HTTPSMiddlewareFunction.hpp for details. */
@@ -40,8 +47,20 @@ private:
 
   // This vector holds all nodes (with callbacks) that are registered
   std::vector<HTTPNode*> * _nodes;
+  // The same nodes, organized by their path to speed up resolving
+  RouteTrie _routes;
   HTTPNode * _defaultNode;
 
+  // Static response that is sent if no node matches. The status line and headers are serialized
+  // together with the body, so the response can be sent with a single write
+  struct {
+    uint16_t statusCode = 0;
+    std::string statusText;
+    std::string contentType;
+    std::string body;
+    std::string rendered;
+  } _defaultResponse;
+
   // Middleware functions, if any are registered. Will be called in order of the vector.
   std::vector<const HTTPSMiddlewareFunction*> _middleware;
 };
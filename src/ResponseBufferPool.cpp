@@ -0,0 +1,70 @@
+#include "ResponseBufferPool.hpp"
+
+namespace httpsserver {
+
+ResponseBufferPool::ResponseBufferPool() {
+  _storage = NULL;
+  _bufferSize = 0;
+  _free = NULL;
+}
+
+ResponseBufferPool::~ResponseBufferPool() {
+  destroy();
+}
+
+/**
+ * Allocates count buffers of bufferSize bytes each. Any previous buffers are freed.
+ */
+void ResponseBufferPool::create(uint8_t count, size_t bufferSize) {
+  destroy();
+  if (count == 0) {
+    return;
+  }
+  _bufferSize = bufferSize;
+  _storage = new byte[count * bufferSize];
+  _free = new LockFreeQueue<byte*>(count);
+  for (uint8_t i = 0; i < count; i++) {
+    _free->push(_storage + i * bufferSize);
+  }
+}
+
+/**
+ * Frees all buffers. None of them may be in use anymore.
+ */
+void ResponseBufferPool::destroy() {
+  if (_free != NULL) {
+    delete _free;
+    _free = NULL;
+  }
+  if (_storage != NULL) {
+    delete[] _storage;
+    _storage = NULL;
+  }
+  _bufferSize = 0;
+}
+
+/**
+ * Returns a free buffer, or NULL if all buffers are in use
+ */
+byte * ResponseBufferPool::acquire() {
+  byte * buffer = NULL;
+  if (_free != NULL && _free->pop(buffer)) {
+    return buffer;
+  }
+  return NULL;
+}
+
+/**
+ * Returns a buffer that has been obtained by acquire() to the pool
+ */
+void ResponseBufferPool::release(byte * buffer) {
+  if (_free != NULL && buffer != NULL) {
+    _free->push(buffer);
+  }
+}
+
+size_t ResponseBufferPool::getBufferSize() {
+  return _bufferSize;
+}
+
+} /* namespace httpsserver */
@@ -0,0 +1,40 @@
+#ifndef SRC_RESPONSEBUFFERPOOL_HPP_
+#define SRC_RESPONSEBUFFERPOOL_HPP_
+
+#include <Arduino.h>
+
+#include "HTTPSServerConstants.hpp"
+#include "LockFreeQueue.hpp"
+
+namespace httpsserver {
+
+/**
+ * \brief Fixed set of buffers that are used by responses to cache their content
+ *
+ * The buffers are allocated once in create(). Afterwards, acquire() and release() hand them out and
+ * take them back without touching the heap. Both may be called from different tasks concurrently.
+ */
+class ResponseBufferPool {
+public:
+  ResponseBufferPool();
+  virtual ~ResponseBufferPool();
+
+  void create(uint8_t count, size_t bufferSize);
+  void destroy();
+
+  byte * acquire();
+  void release(byte * buffer);
+
+  size_t getBufferSize();
+
+private:
+  // Memory of all buffers
+  byte * _storage;
+  size_t _bufferSize;
+  // Buffers that are currently not in use
+  LockFreeQueue<byte*> * _free;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_RESPONSEBUFFERPOOL_HPP_ */
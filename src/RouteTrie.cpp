@@ -0,0 +1,178 @@
+#include "RouteTrie.hpp"
+
+namespace httpsserver {
+
+// Order value for "nothing found yet"
+#define ROUTETRIE_NO_ORDER ((size_t)-1)
+
+/**
+ * Compares a segment with the segment of a tree node like std::string::compare()
+ */
+static int compareSegment(StringView const &a, std::string const &b) {
+  size_t length = (a.length() < b.length() ? a.length() : b.length());
+  int res = memcmp(a.data(), b.data(), length);
+  if (res != 0) {
+    return res;
+  }
+  return (a.length() < b.length() ? -1 : (a.length() > b.length() ? 1 : 0));
+}
+
+RouteTrie::RouteTrie() {
+  _root = createNode(StringView(), ROUTETRIE_NO_ORDER);
+  _nodeCount = 0;
+}
+
+RouteTrie::~RouteTrie() {
+  deleteNode(_root);
+}
+
+/**
+ * Returns the start of the segment following the one that starts at start, or StringView::npos if
+ * it is the last segment of the path
+ */
+size_t RouteTrie::nextSegment(StringView const &path, size_t start) {
+  size_t slash = path.find('/', start);
+  return (slash == StringView::npos ? StringView::npos : slash + 1);
+}
+
+/**
+ * Returns the segment from start up to (excluding) the slash before next
+ */
+StringView RouteTrie::getSegment(StringView const &path, size_t start, size_t next) {
+  return path.substr(start, next == StringView::npos ? StringView::npos : next - 1 - start);
+}
+
+/**
+ * Adds a node to the tree. Nodes that are inserted earlier take precedence if several nodes match.
+ */
+void RouteTrie::insert(HTTPNode * node) {
+  size_t order = _nodeCount++;
+  StringView path(node->_path);
+  TrieNode * current = _root;
+  bool first = true;
+  size_t start = 0;
+  while(start != StringView::npos) {
+    size_t next = nextSegment(path, start);
+    StringView segment = getSegment(path, start, next);
+
+    // An asterisk is only a parameter if it is preceded by a slash
+    TrieNode * child;
+    if (!first && segment.equals("*")) {
+      if (current->wildcard == NULL) {
+        current->wildcard = createNode(segment, order);
+      }
+      child = current->wildcard;
+    } else {
+      child = findChild(current, segment);
+      if (child == NULL) {
+        child = createNode(segment, order);
+        // Keep the children sorted, so that findChild() can use a binary search
+        std::vector<TrieNode*>::iterator pos = current->children.begin();
+        while(pos != current->children.end() && compareSegment(segment, (*pos)->segment) > 0) {
+          ++pos;
+        }
+        current->children.insert(pos, child);
+      }
+    }
+    current = child;
+    first = false;
+    start = next;
+  }
+
+  Leaf leaf;
+  leaf.node = node;
+  leaf.order = order;
+  current->leaves.push_back(leaf);
+}
+
+/**
+ * Removes all nodes from the tree
+ */
+void RouteTrie::clear() {
+  deleteNode(_root);
+  _root = createNode(StringView(), ROUTETRIE_NO_ORDER);
+  _nodeCount = 0;
+}
+
+/**
+ * Returns the first inserted node of the given type that matches method and path (without query
+ * string), or NULL.
+ */
+HTTPNode * RouteTrie::match(std::string const &method, StringView const &path, HTTPNodeType nodeType) {
+  Leaf best;
+  best.node = NULL;
+  best.order = ROUTETRIE_NO_ORDER;
+  matchNode(_root, method, path, 0, nodeType, best);
+  return best.node;
+}
+
+void RouteTrie::matchNode(TrieNode * node, std::string const &method, StringView const &path, size_t segmentStart,
+    HTTPNodeType nodeType, Leaf &best) {
+  if (segmentStart == StringView::npos) {
+    // The whole path has been consumed, check the nodes that end here
+    for(std::vector<Leaf>::iterator leaf = node->leaves.begin(); leaf != node->leaves.end(); ++leaf) {
+      HTTPNode * candidate = leaf->node;
+      if (leaf->order < best.order && candidate->_nodeType == nodeType && (
+        // For handler functions, check the method declared with the node
+        (nodeType == HANDLER_CALLBACK && ((ResourceNode*)candidate)->_method == method) ||
+        // For websockets, the specification says that GET is the only choice
+        (nodeType == WEBSOCKET && method == "GET")
+      )) {
+        best = *leaf;
+      }
+    }
+    return;
+  }
+
+  size_t next = nextSegment(path, segmentStart);
+  StringView segment = getSegment(path, segmentStart, next);
+
+  // Only descend into subtrees that might contain a node inserted before the best match so far
+  TrieNode * child = findChild(node, segment);
+  if (child != NULL && child->minOrder < best.order) {
+    matchNode(child, method, path, next, nodeType, best);
+  }
+  if (node->wildcard != NULL && node->wildcard->minOrder < best.order) {
+    matchNode(node->wildcard, method, path, next, nodeType, best);
+  }
+}
+
+RouteTrie::TrieNode * RouteTrie::createNode(StringView const &segment, size_t order) {
+  TrieNode * node = new TrieNode();
+  node->segment = segment.toString();
+  node->wildcard = NULL;
+  node->minOrder = order;
+  return node;
+}
+
+void RouteTrie::deleteNode(TrieNode * node) {
+  for(std::vector<TrieNode*>::iterator child = node->children.begin(); child != node->children.end(); ++child) {
+    deleteNode(*child);
+  }
+  if (node->wildcard != NULL) {
+    deleteNode(node->wildcard);
+  }
+  delete node;
+}
+
+/**
+ * Finds the child for a static segment by binary search
+ */
+RouteTrie::TrieNode * RouteTrie::findChild(TrieNode * node, StringView const &segment) {
+  size_t low = 0;
+  size_t high = node->children.size();
+  while(low < high) {
+    size_t mid = (low + high) / 2;
+    int res = compareSegment(segment, node->children[mid]->segment);
+    if (res == 0) {
+      return node->children[mid];
+    } else if (res < 0) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  return NULL;
+}
+
+} /* namespace httpsserver */
@@ -0,0 +1,74 @@
+#ifndef SRC_ROUTETRIE_HPP_
+#define SRC_ROUTETRIE_HPP_
+
+#include <Arduino.h>
+#include <string>
+// Arduino declares it's own min max, incompatible with the stl...
+#undef min
+#undef max
+#include <vector>
+
+#include "HTTPNode.hpp"
+#include "ResourceNode.hpp"
+#include "WebsocketNode.hpp"
+#include "StringView.hpp"
+
+namespace httpsserver {
+
+/**
+ * \brief Prefix tree of the registered nodes, keyed by path segment
+ *
+ * Used internally by the ResourceResolver. Each level of the tree represents one segment of the path
+ * (the part between two slashes). A segment that is only an asterisk (a path parameter) is stored as
+ * wildcard edge, which matches any segment. The nodes are stored at the tree node of their last
+ * segment.
+ *
+ * Matching a path only visits the tree nodes along the path and does not allocate memory. If several
+ * nodes match, the one that has been inserted first is returned, like with a linear search over all
+ * nodes.
+ */
+class RouteTrie {
+public:
+  RouteTrie();
+  virtual ~RouteTrie();
+
+  void insert(HTTPNode * node);
+  void clear();
+  HTTPNode * match(std::string const &method, StringView const &path, HTTPNodeType nodeType);
+
+  static size_t nextSegment(StringView const &path, size_t start);
+  static StringView getSegment(StringView const &path, size_t start, size_t next);
+
+private:
+  // An HTTPNode stored in the tree, with the position in which it has been inserted
+  struct Leaf {
+    HTTPNode * node;
+    size_t order;
+  };
+
+  // Node of the tree, represents one path segment
+  struct TrieNode {
+    std::string segment;
+    // Children for static segments, sorted by segment
+    std::vector<TrieNode*> children;
+    // Child for a path parameter (NULL if there is none)
+    TrieNode * wildcard;
+    // HTTPNodes whose path ends here
+    std::vector<Leaf> leaves;
+    // Lowest order of all leaves in this subtree
+    size_t minOrder;
+  };
+
+  TrieNode * createNode(StringView const &segment, size_t order);
+  void deleteNode(TrieNode * node);
+  TrieNode * findChild(TrieNode * node, StringView const &segment);
+  void matchNode(TrieNode * node, std::string const &method, StringView const &path, size_t segmentStart,
+    HTTPNodeType nodeType, Leaf &best);
+
+  TrieNode * _root;
+  size_t _nodeCount;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_ROUTETRIE_HPP_ */
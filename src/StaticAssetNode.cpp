@@ -0,0 +1,354 @@
+#include "StaticAssetNode.hpp"
+
+namespace httpsserver {
+
+/**
+ * Returns the directory part of a node path, which is removed from the request path to get the name
+ * of the file. That is everything before the last slash in front of the first wildcard.
+ */
+static std::string getPathPrefix(const std::string &path) {
+  std::string prefix = path.substr(0, path.find('*'));
+  size_t slash = prefix.rfind('/');
+  return (slash == std::string::npos ? std::string() : prefix.substr(0, slash));
+}
+
+StaticAssetNode::StaticAssetNode(const std::string &path, const StaticAsset * assets, size_t assetCount, const std::string &tag):
+  ResourceNode(path, "GET", &StaticAssetNode::handleRequest, tag),
+  _prefix(getPathPrefix(path)),
+  _assets(assets),
+  _assetCount(assetCount),
+  _assetsSorted(true),
+  _fs(NULL),
+  _rootDir() {
+  for (size_t i = 1; i < assetCount; i++) {
+    if (strcmp(assets[i - 1].path, assets[i].path) >= 0) {
+      _assetsSorted = false;
+      break;
+    }
+  }
+}
+
+StaticAssetNode::StaticAssetNode(const std::string &path, fs::FS &fs, const std::string &rootDir, const std::string &tag):
+  ResourceNode(path, "GET", &StaticAssetNode::handleRequest, tag),
+  _prefix(getPathPrefix(path)),
+  _assets(NULL),
+  _assetCount(0),
+  _assetsSorted(false),
+  _fs(&fs),
+  _rootDir(rootDir) {
+  if (!_rootDir.empty() && _rootDir[_rootDir.length() - 1] == '/') {
+    _rootDir.erase(_rootDir.length() - 1);
+  }
+}
+
+StaticAssetNode::~StaticAssetNode() {
+
+}
+
+/**
+ * Returns the content type for a file name, based on its extension
+ */
+const char * StaticAssetNode::getContentType(const std::string &path) {
+  static const struct {
+    const char * extension;
+    const char * contentType;
+  } types[] = {
+    {"html",  "text/html"},
+    {"htm",   "text/html"},
+    {"css",   "text/css"},
+    {"js",    "application/javascript"},
+    {"mjs",   "application/javascript"},
+    {"json",  "application/json"},
+    {"map",   "application/json"},
+    {"txt",   "text/plain"},
+    {"xml",   "text/xml"},
+    {"svg",   "image/svg+xml"},
+    {"png",   "image/png"},
+    {"jpg",   "image/jpeg"},
+    {"jpeg",  "image/jpeg"},
+    {"gif",   "image/gif"},
+    {"webp",  "image/webp"},
+    {"ico",   "image/x-icon"},
+    {"woff",  "font/woff"},
+    {"woff2", "font/woff2"},
+    {"ttf",   "font/ttf"},
+    {"wasm",  "application/wasm"},
+    {"pdf",   "application/pdf"},
+    {"mp3",   "audio/mpeg"},
+    {"mp4",   "video/mp4"},
+  };
+
+  size_t dot = path.rfind('.');
+  if (dot != std::string::npos && path.find('/', dot) == std::string::npos) {
+    StringView extension = StringView(path).substr(dot + 1);
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+      if (extension.equalsIgnoreCase(types[i].extension)) {
+        return types[i].contentType;
+      }
+    }
+  }
+  return "application/octet-stream";
+}
+
+/**
+ * Returns true if the If-None-Match header contains the ETag (or is "*")
+ */
+static bool matchesETag(StringView const &header, std::string const &etag) {
+  size_t start = 0;
+  while (start < header.length()) {
+    size_t end = header.find(',', start);
+    if (end == StringView::npos) {
+      end = header.length();
+    }
+    StringView token = header.substr(start, end - start).trim();
+    // If-None-Match uses the weak comparison, so the W/ prefix is ignored
+    if (token.length() > 2 && token[0] == 'W' && token[1] == '/') {
+      token = token.substr(2);
+    }
+    if (token.equals("*") || token.equals(etag)) {
+      return true;
+    }
+    start = end + 1;
+  }
+  return false;
+}
+
+/**
+ * Returns the ETag of a compressed variant. Each variant needs its own strong ETag, so a suffix is
+ * added inside the quotes.
+ */
+static std::string variantETag(std::string const &etag, const char * suffix) {
+  if (etag.length() < 2 || etag[etag.length() - 1] != '"') {
+    return etag;
+  }
+  return etag.substr(0, etag.length() - 1) + "-" + suffix + "\"";
+}
+
+/**
+ * Answers the request with 304 Not Modified if the client already has the current version. Returns
+ * true if it did so.
+ */
+static bool sendNotModified(HTTPRequest * req, HTTPResponse * res, std::string const &etag) {
+  StringView ifNoneMatch = req->getHeaderView(HEADER_ID_IF_NONE_MATCH);
+  if (etag.empty() || ifNoneMatch.empty() || !matchesETag(ifNoneMatch, etag)) {
+    return false;
+  }
+  res->setStatusCode(304);
+  res->setStatusText("Not Modified");
+  res->setHeader("ETag", etag);
+  return true;
+}
+
+/**
+ * Sets the headers of a (possibly compressed) file
+ */
+static void setAssetHeaders(HTTPResponse * res, const char * contentType, std::string const &etag, const char * encoding, bool hasVariants) {
+  res->setHeader("Content-Type", contentType);
+  if (encoding != NULL) {
+    res->setHeader("Content-Encoding", encoding);
+  }
+  if (hasVariants) {
+    res->setHeader("Vary", "Accept-Encoding");
+  }
+  if (!etag.empty()) {
+    res->setHeader("ETag", etag);
+  }
+}
+
+void StaticAssetNode::handleRequest(HTTPRequest * req, HTTPResponse * res) {
+  StaticAssetNode * node = static_cast<StaticAssetNode*>(req->getResolvedNode());
+  std::string path = node->getAssetPath(req);
+
+  if (node->_fs != NULL) {
+    node->serveFile(req, res, path);
+  } else {
+    const StaticAsset * asset = node->findAsset(path);
+    if (asset != NULL) {
+      node->serveAsset(req, res, asset);
+    } else {
+      res->setStatusCode(404);
+      res->setStatusText("Not Found");
+      res->setHeader("Content-Type", "text/plain");
+      res->print("Not Found");
+    }
+  }
+}
+
+/**
+ * Returns the path of the requested file relative to the node, without the query string
+ */
+std::string StaticAssetNode::getAssetPath(HTTPRequest * req) {
+  std::string const &url = req->getRequestString();
+  std::string path = urlDecode(url.substr(0, url.find('?')));
+  if (path.compare(0, _prefix.length(), _prefix) == 0) {
+    path.erase(0, _prefix.length());
+  }
+  if (path.empty() || path[0] != '/') {
+    path.insert(0, "/");
+  }
+  if (path[path.length() - 1] == '/') {
+    path += "index.html";
+  }
+  return path;
+}
+
+const StaticAsset * StaticAssetNode::findAsset(const std::string &path) {
+  if (_assetsSorted) {
+    size_t low = 0;
+    size_t high = _assetCount;
+    while (low < high) {
+      size_t mid = low + (high - low) / 2;
+      int cmp = strcmp(_assets[mid].path, path.c_str());
+      if (cmp == 0) {
+        return &_assets[mid];
+      } else if (cmp < 0) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    return NULL;
+  }
+  for (size_t i = 0; i < _assetCount; i++) {
+    if (path == _assets[i].path) {
+      return &_assets[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Sends a file from flash. The data is written directly from flash in pieces of
+ * HTTPS_STATIC_CHUNK_SIZE bytes.
+ */
+void StaticAssetNode::serveAsset(HTTPRequest * req, HTTPResponse * res, const StaticAsset * asset) {
+  std::string etag = (asset->etag != NULL ? asset->etag : "");
+  const uint8_t * data = asset->data;
+  size_t length = asset->length;
+  const char * encoding = NULL;
+  const char * headers = asset->headers;
+
+  StringView acceptEncoding = req->getHeaderView(HEADER_ID_ACCEPT_ENCODING);
+  if (asset->brotliData != NULL && acceptsEncoding(acceptEncoding, "br")) {
+    data = asset->brotliData;
+    length = asset->brotliLength;
+    encoding = "br";
+    headers = asset->brotliHeaders;
+  } else if (asset->gzipData != NULL && acceptsEncoding(acceptEncoding, "gzip")) {
+    data = asset->gzipData;
+    length = asset->gzipLength;
+    encoding = "gzip";
+    headers = asset->gzipHeaders;
+  }
+  if (encoding != NULL) {
+    etag = variantETag(etag, encoding);
+  }
+
+  bool hasVariants = (asset->brotliData != NULL || asset->gzipData != NULL);
+  if (sendNotModified(req, res, etag)) {
+    if (hasVariants) {
+      res->setHeader("Vary", "Accept-Encoding");
+    }
+    return;
+  }
+
+  if (headers != NULL) {
+    res->setSerializedHeaders(headers);
+  } else {
+    setAssetHeaders(res, asset->contentType != NULL ? asset->contentType : getContentType(asset->path), etag, encoding, hasVariants);
+  }
+  res->setContentLength(length);
+  // The body is written whenever the client can take more, so a slow client does not hold up the server
+  size_t offset = 0;
+  res->onWritable([res, data, length, offset]() mutable {
+    while (offset < length) {
+      if (res->availableForWrite() == 0) {
+        return true;
+      }
+      size_t pieceLength = std::min(length - offset, (size_t)HTTPS_STATIC_CHUNK_SIZE);
+      res->write(data + offset, pieceLength);
+      offset += pieceLength;
+    }
+    return false;
+  });
+}
+
+/**
+ * Sends a file from the file system. The ETag is derived from the size and modification time of the
+ * file.
+ */
+void StaticAssetNode::serveFile(HTTPRequest * req, HTTPResponse * res, const std::string &path) {
+  fs::File file;
+  const char * encoding = NULL;
+  bool hasVariants = false;
+
+  // Do not leave the root directory
+  if (path.find("..") == std::string::npos) {
+    std::string filePath = _rootDir + path;
+    StringView acceptEncoding = req->getHeaderView(HEADER_ID_ACCEPT_ENCODING);
+    if (_fs->exists((filePath + ".br").c_str())) {
+      hasVariants = true;
+      if (acceptsEncoding(acceptEncoding, "br")) {
+        file = _fs->open((filePath + ".br").c_str(), "r");
+        encoding = "br";
+      }
+    }
+    if (!file && _fs->exists((filePath + ".gz").c_str())) {
+      hasVariants = true;
+      if (acceptsEncoding(acceptEncoding, "gzip")) {
+        file = _fs->open((filePath + ".gz").c_str(), "r");
+        encoding = "gzip";
+      }
+    }
+    if (!file && _fs->exists(filePath.c_str())) {
+      file = _fs->open(filePath.c_str(), "r");
+      encoding = NULL;
+    }
+  }
+
+  if (!file || file.isDirectory()) {
+    res->setStatusCode(404);
+    res->setStatusText("Not Found");
+    res->setHeader("Content-Type", "text/plain");
+    res->print("Not Found");
+    return;
+  }
+
+  size_t length = file.size();
+  char etagBuffer[32];
+  snprintf(etagBuffer, sizeof(etagBuffer), "\"%x-%lx\"", (unsigned int)length, (unsigned long)file.getLastWrite());
+  std::string etag = etagBuffer;
+
+  if (sendNotModified(req, res, etag)) {
+    if (hasVariants) {
+      res->setHeader("Vary", "Accept-Encoding");
+    }
+    file.close();
+    return;
+  }
+
+  setAssetHeaders(res, getContentType(path), etag, encoding, hasVariants);
+  res->setContentLength(length);
+  // Like for assets, the file is read whenever the client can take more. Only as much is read as can be
+  // written, so nothing has to be kept in between
+  size_t remaining = length;
+  res->onWritable([res, file, remaining, path]() mutable {
+    byte buffer[HTTPS_STATIC_CHUNK_SIZE];
+    while (remaining > 0) {
+      if (res->availableForWrite() == 0) {
+        return true;
+      }
+      size_t readLength = file.read(buffer, std::min(remaining, sizeof(buffer)));
+      if (readLength == 0) {
+        HTTPS_LOGE("Could not read %s", path.c_str());
+        break;
+      }
+      res->write(buffer, readLength);
+      remaining -= readLength;
+    }
+    file.close();
+    return false;
+  });
+}
+
+} /* namespace httpsserver */
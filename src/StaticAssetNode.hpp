@@ -0,0 +1,94 @@
+#ifndef SRC_STATICASSETNODE_HPP_
+#define SRC_STATICASSETNODE_HPP_
+
+#include <Arduino.h>
+#include <FS.h>
+#include <string>
+// Arduino declares it's own min max, incompatible with the stl...
+#undef min
+#undef max
+#include <algorithm>
+
+#include "HTTPSServerConstants.hpp"
+#include "ResourceNode.hpp"
+#include "HTTPRequest.hpp"
+#include "HTTPResponse.hpp"
+#include "StringView.hpp"
+#include "util.hpp"
+
+namespace httpsserver {
+
+/**
+ * \brief A file that is stored in flash and served by a StaticAssetNode
+ *
+ * The compressed variants are optional (NULL if not available). If contentType is NULL, it is
+ * derived from the extension of the path.
+ *
+ * The headers of each variant can be provided already serialized (like "Content-Type: text/html\r\n",
+ * see HTTPResponse::setSerializedHeaders()). Then they must contain Content-Type, ETag, and if there
+ * are compressed variants, Content-Encoding and Vary. Tables like this can be created with
+ * extras/pack_assets.py.
+ */
+struct StaticAsset {
+  // Path relative to the node, like "/index.html"
+  const char * path;
+  const char * contentType;
+  // Strong ETag of the uncompressed content, including the quotes, or NULL
+  const char * etag;
+  const uint8_t * data;
+  size_t length;
+  const uint8_t * gzipData;
+  size_t gzipLength;
+  const uint8_t * brotliData;
+  size_t brotliLength;
+  // Serialized headers for each variant, or NULL
+  const char * headers;
+  const char * gzipHeaders;
+  const char * brotliHeaders;
+};
+
+/**
+ * \brief HTTPNode that serves static files from flash or from a file system
+ *
+ * The name of the file is the request path without the directory of the node path (the part up to
+ * the last slash in front of the first wildcard). So if the node path is "/static/" followed by a
+ * wildcard, "/static/app.js" is served as "/app.js", and a node for "/favicon.ico" serves
+ * "/favicon.ico". Paths ending with a slash are served as ".../index.html". The node can also be used
+ * as default node.
+ *
+ * If the client accepts it, a brotli or gzip compressed variant is sent instead of the file (for the
+ * file system, a file with the same name and the extension .br or .gz). Responses carry an ETag, so
+ * that requests with a matching If-None-Match header are answered with 304 Not Modified.
+ */
+class StaticAssetNode : public ResourceNode {
+public:
+  StaticAssetNode(const std::string &path, const StaticAsset * assets, size_t assetCount, const std::string &tag = "");
+  StaticAssetNode(const std::string &path, fs::FS &fs, const std::string &rootDir, const std::string &tag = "");
+  virtual ~StaticAssetNode();
+
+  static const char * getContentType(const std::string &path);
+
+private:
+  static void handleRequest(HTTPRequest * req, HTTPResponse * res);
+
+  std::string getAssetPath(HTTPRequest * req);
+  const StaticAsset * findAsset(const std::string &path);
+  void serveAsset(HTTPRequest * req, HTTPResponse * res, const StaticAsset * asset);
+  void serveFile(HTTPRequest * req, HTTPResponse * res, const std::string &path);
+
+  // Part of the node path in front of the wildcard
+  std::string _prefix;
+
+  // Assets in flash. If they are sorted by path, they are found by binary search
+  const StaticAsset * _assets;
+  size_t _assetCount;
+  bool _assetsSorted;
+
+  // File system and the directory that contains the files
+  fs::FS * _fs;
+  std::string _rootDir;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_STATICASSETNODE_HPP_ */
@@ -0,0 +1,119 @@
+#include "StringView.hpp"
+
+namespace httpsserver {
+
+StringView::StringView():
+  _data(""),
+  _length(0) {
+
+}
+
+StringView::StringView(const char * data, size_t length):
+  _data(data),
+  _length(length) {
+
+}
+
+StringView::StringView(const char * str):
+  _data(str),
+  _length(strlen(str)) {
+
+}
+
+StringView::StringView(std::string const &str):
+  _data(str.data()),
+  _length(str.length()) {
+
+}
+
+const char * StringView::data() const {
+  return _data;
+}
+
+size_t StringView::length() const {
+  return _length;
+}
+
+bool StringView::empty() const {
+  return _length == 0;
+}
+
+char StringView::operator[](size_t idx) const {
+  return _data[idx];
+}
+
+bool StringView::equals(StringView const &other) const {
+  return _length == other._length && memcmp(_data, other._data, _length) == 0;
+}
+
+/**
+ * Compares the views ignoring the case of ASCII letters, as required for header names and tokens
+ */
+bool StringView::equalsIgnoreCase(StringView const &other) const {
+  if (_length != other._length) {
+    return false;
+  }
+  for(size_t i = 0; i < _length; i++) {
+    if (tolower((unsigned char)_data[i]) != tolower((unsigned char)other._data[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Returns the index of the first occurrence of c at or after start, or npos
+ */
+size_t StringView::find(char c, size_t start) const {
+  if (start >= _length) {
+    return npos;
+  }
+  const char * match = (const char *)memchr(_data + start, c, _length - start);
+  return (match == NULL ? npos : match - _data);
+}
+
+/**
+ * Returns the index of the first occurrence of other, or npos
+ */
+size_t StringView::find(StringView const &other) const {
+  if (other._length > _length) {
+    return npos;
+  }
+  for(size_t i = 0; i + other._length <= _length; i++) {
+    if (memcmp(_data + i, other._data, other._length) == 0) {
+      return i;
+    }
+  }
+  return npos;
+}
+
+StringView StringView::substr(size_t start, size_t length) const {
+  if (start > _length) {
+    start = _length;
+  }
+  if (length > _length - start) {
+    length = _length - start;
+  }
+  return StringView(_data + start, length);
+}
+
+/**
+ * Returns the view without leading and trailing spaces and tabs
+ */
+StringView StringView::trim() const {
+  size_t start = 0;
+  size_t end = _length;
+  while (start < end && (_data[start] == ' ' || _data[start] == '\t')) {
+    start++;
+  }
+  while (end > start && (_data[end - 1] == ' ' || _data[end - 1] == '\t')) {
+    end--;
+  }
+  return StringView(_data + start, end - start);
+}
+
+std::string StringView::toString() const {
+  return std::string(_data, _length);
+}
+
+} /* namespace httpsserver */
@@ -0,0 +1,46 @@
+#ifndef SRC_STRINGVIEW_HPP_
+#define SRC_STRINGVIEW_HPP_
+
+#include <Arduino.h>
+#include <string.h>
+#include <string>
+
+namespace httpsserver {
+
+/**
+ * \brief Non-owning reference to a sequence of characters
+ *
+ * A view is used to access parts of a request (like header values) without copying them. It is only
+ * valid as long as the memory it refers to is, which for request data means until the request has
+ * been handled. The data is not null-terminated, use toString() to get a copy if required.
+ */
+class StringView {
+public:
+  StringView();
+  StringView(const char * data, size_t length);
+  StringView(const char * str);
+  StringView(std::string const &str);
+
+  const char * data() const;
+  size_t length() const;
+  bool empty() const;
+  char operator[](size_t idx) const;
+
+  bool equals(StringView const &other) const;
+  bool equalsIgnoreCase(StringView const &other) const;
+  size_t find(char c, size_t start = 0) const;
+  size_t find(StringView const &other) const;
+  StringView substr(size_t start, size_t length = npos) const;
+  StringView trim() const;
+  std::string toString() const;
+
+  static const size_t npos = (size_t)-1;
+
+private:
+  const char * _data;
+  size_t _length;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_STRINGVIEW_HPP_ */
@@ -0,0 +1,96 @@
+#include "WakeupSocket.hpp"
+
+namespace httpsserver {
+
+/**
+ * Created by the owner, which holds the first reference.
+ */
+WakeupSocket::WakeupSocket() {
+  _socket = -1;
+  _signalled = false;
+  _refCount = 1;
+}
+
+WakeupSocket::~WakeupSocket() {
+  close();
+}
+
+/**
+ * Creates the socket. Returns true on success.
+ */
+bool WakeupSocket::open() {
+  if (_socket >= 0) {
+    return true;
+  }
+  _socket = socket(AF_INET, SOCK_DGRAM, 0);
+  if (_socket < 0) {
+    HTTPS_LOGE("Could not create wakeup socket");
+    return false;
+  }
+
+  // Bind to an arbitrary port on the loopback interface and find out which one we got
+  memset(&_addr, 0, sizeof(_addr));
+  _addr.sin_family = AF_INET;
+  _addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  _addr.sin_port = 0;
+  socklen_t addrLen = sizeof(_addr);
+  if (bind(_socket, (struct sockaddr *)&_addr, sizeof(_addr)) != 0 ||
+      getsockname(_socket, (struct sockaddr *)&_addr, &addrLen) != 0) {
+    HTTPS_LOGE("Could not bind wakeup socket");
+    close();
+    return false;
+  }
+
+  _signalled = false;
+  return true;
+}
+
+void WakeupSocket::close() {
+  if (_socket >= 0) {
+    ::close(_socket);
+    _socket = -1;
+  }
+}
+
+int WakeupSocket::getSocket() {
+  return _socket;
+}
+
+/**
+ * Makes the socket readable. May be called from any task.
+ */
+void WakeupSocket::signal() {
+  // Only send a datagram if the previous one has already been cleared
+  if (_socket >= 0 && !_signalled.exchange(true)) {
+    byte b = 0;
+    sendto(_socket, &b, 1, MSG_DONTWAIT, (struct sockaddr *)&_addr, sizeof(_addr));
+  }
+}
+
+/**
+ * Removes pending signals. Has to be called by the waiting task before it checks for new work.
+ */
+void WakeupSocket::clear() {
+  byte buf[8];
+  while(recv(_socket, buf, sizeof(buf), MSG_DONTWAIT) > 0);
+  _signalled = false;
+}
+
+/**
+ * Adds a reference. Only valid while holding a reference, so objects that are created by a connection
+ * retain the socket of the task that processes it.
+ */
+void WakeupSocket::retain() {
+  _refCount++;
+}
+
+/**
+ * Drops one reference. The last one closes the socket and deletes the object.
+ */
+void WakeupSocket::release() {
+  if (_refCount.fetch_sub(1) == 1) {
+    delete this;
+  }
+}
+
+} /* namespace httpsserver */
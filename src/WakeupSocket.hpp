@@ -0,0 +1,55 @@
+#ifndef SRC_WAKEUPSOCKET_HPP_
+#define SRC_WAKEUPSOCKET_HPP_
+
+#include <Arduino.h>
+#include <atomic>
+
+// Required for sockets
+#include "lwip/netdb.h"
+#undef read
+#include "lwip/sockets.h"
+#include "lwip/inet.h"
+
+#include "HTTPSServerConstants.hpp"
+
+namespace httpsserver {
+
+/**
+ * \brief Socket that is used to wake up a task that waits in select()
+ *
+ * The socket is a UDP socket bound to the loopback interface. Other tasks call signal() to make it
+ * readable, the waiting task includes getSocket() in its call to select() and calls clear() once it
+ * has been woken up.
+ *
+ * The object is reference counted, because other tasks may still signal it after its owner (the server
+ * or a worker) has stopped. Objects that are used by other tasks, like Completion, retain() it while
+ * they exist. The last release() closes the socket and deletes the object.
+ */
+class WakeupSocket {
+public:
+  WakeupSocket();
+
+  bool open();
+  int getSocket();
+
+  void signal();
+  void clear();
+
+  void retain();
+  void release();
+
+private:
+  virtual ~WakeupSocket();
+  void close();
+
+  int _socket;
+  sockaddr_in _addr;
+  // True if a signal has been sent that has not been cleared yet
+  std::atomic<bool> _signalled;
+  // Number of references held by the owner and by the objects that may signal the socket
+  std::atomic<uint16_t> _refCount;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_WAKEUPSOCKET_HPP_ */
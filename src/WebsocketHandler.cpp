@@ -31,10 +31,15 @@ WebsocketHandler::WebsocketHandler() {
   _con = nullptr;
   _receivedClose = false;
   _sentClose = false;
+  _blockedFrameLength = 0;
+  _sendQueue = NULL;
 }
 
 WebsocketHandler::~WebsocketHandler() {
-
+  if (_sendQueue != NULL) {
+    _sendQueue->close();
+    _sendQueue->release();
+  }
 } // ~WebSocketHandler()
 
 
@@ -69,8 +74,20 @@ void WebsocketHandler::onError(std::string error) {
   HTTPS_LOGD("WebsocketHandler onError()");
 }
 
+/**
+* @brief The default onWritable handler.
+* Called when a message that trySend() could not send would fit into the output queue now. Handlers
+* that produce messages on their own (e.g. sensor values) can send the next one from here.
+*/
+void WebsocketHandler::onWritable() {
+  HTTPS_LOGD("WebsocketHandler onWritable()");
+}
+
 void WebsocketHandler::initialize(ConnectionContext * con) {
   _con = con;
+  if (_sendQueue != NULL) {
+    _sendQueue->setWakeupSocket(_con->openWakeupSocket());
+  }
 }
 
 void WebsocketHandler::loop() {
@@ -189,6 +206,8 @@ void WebsocketHandler::close(uint16_t status, std::string message) {
  * @brief Send data down the web socket
  * See the WebSocket spec (RFC6455) section "6.1 Sending Data".
  * We build a WebSocket frame, send the frame followed by the data.
+ * The call does not wait for the client. Data that the client does not accept right away is queued,
+ * even if the output queue is full already. Use trySend() to keep to the size of the queue.
  * @param [in] data The data to send down the WebSocket.
  * @param [in] sendType The type of payload.  Either SEND_TYPE_TEXT or SEND_TYPE_BINARY.
  */
@@ -219,6 +238,8 @@ void WebsocketHandler::send(std::string data, uint8_t sendType) {
  * @brief Send data down the web socket
  * See the WebSocket spec (RFC6455) section "6.1 Sending Data".
  * We build a WebSocket frame, send the frame followed by the data.
+ * The call does not wait for the client. Data that the client does not accept right away is queued,
+ * even if the output queue is full already. Use trySend() to keep to the size of the queue.
  * @param [in] data The data to send down the WebSocket.
  * @param [in] sendType The type of payload.  Either SEND_TYPE_TEXT or SEND_TYPE_BINARY.
  */
@@ -244,6 +265,114 @@ void WebsocketHandler::send(uint8_t* data, uint16_t length, uint8_t sendType) {
   HTTPS_LOGD("<< Websocket.send()");
 }  // Websocket::send
 
+/**
+ * @brief Send data down the web socket if it fits into the output queue
+ * The frame is only sent if the output queue of the connection can take all of it. Otherwise, nothing
+ * is sent and onWritable() is called as soon as there is enough space. Frames that are larger than
+ * HTTPS_OUTPUT_QUEUE_SIZE can only be sent with send().
+ * @param [in] data The data to send down the WebSocket.
+ * @param [in] sendType The type of payload.  Either SEND_TYPE_TEXT or SEND_TYPE_BINARY.
+ * @return true if the frame has been sent, false if the output queue is too full.
+ */
+bool WebsocketHandler::trySend(std::string const &data, uint8_t sendType) {
+  if (!reserveFrame(data.length())) {
+    return false;
+  }
+  send((uint8_t*)data.data(), (uint16_t)data.length(), sendType);
+  return true;
+}
+
+/**
+ * @brief Send data down the web socket if it fits into the output queue
+ * See trySend(std::string const &, uint8_t).
+ */
+bool WebsocketHandler::trySend(uint8_t* data, uint16_t length, uint8_t sendType) {
+  if (!reserveFrame(length)) {
+    return false;
+  }
+  send(data, length, sendType);
+  return true;
+}
+
+/**
+ * Returns true if a frame with the given payload length fits into the output queue. Otherwise, the
+ * length is remembered for checkWritable().
+ */
+bool WebsocketHandler::reserveFrame(size_t length) {
+  size_t frameLength = length + (length < 126 ? 2 : 4);
+  if (length > 0xFFFF || frameLength > HTTPS_OUTPUT_QUEUE_SIZE) {
+    HTTPS_LOGW("Websocket frame of %u bytes does not fit into the output queue", length);
+    return false;
+  }
+  if (_con->getOutputSpace() < frameLength) {
+    _blockedFrameLength = frameLength;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Called by the connection. Calls onWritable() if the frame that trySend() could not send before would
+ * fit into the output queue now.
+ */
+void WebsocketHandler::checkWritable() {
+  if (_blockedFrameLength > 0 && _con->getOutputSpace() >= _blockedFrameLength) {
+    _blockedFrameLength = 0;
+    onWritable();
+  }
+}
+
+/**
+ * @brief Create the queue through which other tasks send messages
+ * send() and trySend() may only be called from the task that runs the server. Other tasks send through
+ * the returned queue instead, from which the server sends the messages in order as soon as they fit into
+ * the output queue. The queue stays valid after the websocket has been closed, until the task releases
+ * it. Must be called once, from the server task (e.g. in the constructor of the handler).
+ * @param [in] depth Number of messages that the queue can hold (rounded up to a power of two).
+ * @param [in] overflowPolicy What happens to messages if the queue is full, see WebsocketSendQueue.
+ * @return The queue, with one reference for the caller.
+ */
+WebsocketSendQueue * WebsocketHandler::createSendQueue(size_t depth, uint8_t overflowPolicy) {
+  if (_sendQueue != NULL) {
+    HTTPS_LOGE("The websocket already has a send queue");
+    _sendQueue->retain();
+    return _sendQueue;
+  }
+  _sendQueue = new WebsocketSendQueue(depth, overflowPolicy);
+  if (_con != NULL) {
+    _sendQueue->setWakeupSocket(_con->openWakeupSocket());
+  }
+  return _sendQueue;
+}
+
+/**
+ * Called by the connection. Returns true if the next message from the send queue fits into the output
+ * queue.
+ */
+bool WebsocketHandler::canSendQueuedMessages() {
+  if (_sendQueue == NULL || closed()) {
+    return false;
+  }
+  WebsocketSendQueue::Message * message = _sendQueue->front();
+  if (message == NULL) {
+    return false;
+  }
+  size_t length = message->data.length();
+  return _con->getOutputSpace() >= length + (length < 126 ? 2 : 4);
+}
+
+/**
+ * Called by the connection. Sends the messages from the send queue that fit into the output queue. The
+ * others are sent once the socket has taken the queued data.
+ */
+void WebsocketHandler::sendQueuedMessages() {
+  while (canSendQueuedMessages()) {
+    WebsocketSendQueue::Message * message = _sendQueue->front();
+    send((uint8_t*)message->data.data(), (uint16_t)message->data.length(), message->sendType);
+    _sendQueue->popFront();
+  }
+}
+
 /**
  * Returns true if the connection has been closed, either by client or server
  */
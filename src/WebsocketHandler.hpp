@@ -13,6 +13,7 @@
 #include "HTTPSServerConstants.hpp"
 #include "ConnectionContext.hpp"
 #include "WebsocketInputStreambuf.hpp"
+#include "WebsocketSendQueue.hpp"
 
 namespace httpsserver {
 
@@ -65,21 +66,32 @@ public:
   virtual void onClose();
   virtual void onMessage(WebsocketInputStreambuf *pWebsocketInputStreambuf);
   virtual void onError(std::string error);
+  virtual void onWritable();
 
   void close(uint16_t status = CLOSE_NORMAL_CLOSURE, std::string message = "");
   void send(std::string data, uint8_t sendType = SEND_TYPE_BINARY);
   void send(uint8_t *data, uint16_t length, uint8_t sendType = SEND_TYPE_BINARY);
+  bool trySend(std::string const &data, uint8_t sendType = SEND_TYPE_BINARY);
+  bool trySend(uint8_t *data, uint16_t length, uint8_t sendType = SEND_TYPE_BINARY);
   bool closed();
+  WebsocketSendQueue * createSendQueue(size_t depth = HTTPS_WEBSOCKET_QUEUE_DEPTH,
+    uint8_t overflowPolicy = WebsocketSendQueue::OVERFLOW_DROP_OLDEST);
 
   void loop();
   void initialize(ConnectionContext * con);
+  void checkWritable();
+  bool canSendQueuedMessages();
+  void sendQueuedMessages();
 
 private:
   int read();
+  bool reserveFrame(size_t length);
 
   ConnectionContext * _con;
   bool _receivedClose; // True when we have received a close request.
   bool _sentClose; // True when we have sent a close request.
+  size_t _blockedFrameLength; // Length of the last frame that trySend() could not send, or 0.
+  WebsocketSendQueue * _sendQueue; // Messages from other tasks, or NULL.
 };
 
 }
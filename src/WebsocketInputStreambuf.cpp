@@ -43,11 +43,28 @@ WebsocketInputStreambuf::~WebsocketInputStreambuf() {
  * need to be consumed/discarded before we can move on to the next record.
  */
 void WebsocketInputStreambuf::discard() {
-  uint8_t byte;
+  uint8_t buffer[64];
   HTTPS_LOGD(">> WebsocketContext.discard(): %d bytes", _dataLength - _sizeRead);
+  unsigned long lastRead = millis();
   while(_sizeRead < _dataLength) {
-    _con->readBuffer(&byte, 1);
-    _sizeRead++;
+    size_t chunkSize = _dataLength - _sizeRead;
+    if (chunkSize > sizeof(buffer)) {
+      chunkSize = sizeof(buffer);
+    }
+    // The rest of the record may not have arrived yet
+    size_t bytesRead = _con->readBuffer(buffer, chunkSize);
+    if (bytesRead > 0) {
+      _sizeRead += bytesRead;
+      lastRead = millis();
+    } else if (millis() - lastRead > HTTPS_CONNECTION_TIMEOUT) {
+      // Without the rest of this record, the next one cannot be found
+      HTTPS_LOGW("Websocket frame has not been received completely, closing the connection");
+      _con->signalClientClose();
+      // Nothing more is read from this record, neither here nor in underflow()
+      _sizeRead = _dataLength;
+    } else {
+      delay(1);
+    }
   }
   HTTPS_LOGD("<< WebsocketContext.discard()");
 } // WebsocketInputStreambuf::discard
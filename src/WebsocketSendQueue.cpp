@@ -0,0 +1,175 @@
+#include "WebsocketSendQueue.hpp"
+
+namespace httpsserver {
+
+/**
+ * Created by WebsocketHandler::createSendQueue(). The object is referenced by the handler and by the
+ * task that requested it.
+ */
+WebsocketSendQueue::WebsocketSendQueue(size_t depth, uint8_t overflowPolicy):
+  _messages(depth),
+  _overflowPolicy(overflowPolicy) {
+  _latest = NULL;
+  _front = NULL;
+  _closed = false;
+  _refCount = 2;
+  _wakeup = NULL;
+}
+
+WebsocketSendQueue::~WebsocketSendQueue() {
+  Message * message;
+  while (_messages.pop(message)) {
+    delete message;
+  }
+  delete _latest.load();
+  delete _front;
+  WakeupSocket * wakeup = _wakeup;
+  if (wakeup != NULL) {
+    wakeup->release();
+  }
+}
+
+/**
+ * Queues a message for the websocket. May be called from any task.
+ * @param [in] data The data to send down the WebSocket.
+ * @param [in] sendType The type of payload. Either WebsocketHandler::SEND_TYPE_TEXT or SEND_TYPE_BINARY.
+ * @return false if the message has been discarded, because the websocket is closed or the queue is full
+ * (OVERFLOW_DROP_NEWEST only). Messages that are larger than HTTPS_OUTPUT_QUEUE_SIZE cannot be queued.
+ */
+bool WebsocketSendQueue::send(std::string const &data, uint8_t sendType) {
+  if (data.length() > 0xFFFF) {
+    HTTPS_LOGW("Websocket frame of %u bytes does not fit into the output queue", data.length());
+    return false;
+  }
+  return send((const uint8_t *)data.data(), data.length(), sendType);
+}
+
+/**
+ * Queues a message for the websocket. See send(std::string const &, uint8_t).
+ */
+bool WebsocketSendQueue::send(const uint8_t *data, uint16_t length, uint8_t sendType) {
+  if (_closed) {
+    return false;
+  }
+  if (length + (length < 126 ? 2 : 4) > HTTPS_OUTPUT_QUEUE_SIZE) {
+    HTTPS_LOGW("Websocket frame of %u bytes does not fit into the output queue", length);
+    return false;
+  }
+  Message * message = new Message();
+  message->sendType = sendType;
+  message->data.assign((const char *)data, length);
+  if (!enqueue(message)) {
+    delete message;
+    return false;
+  }
+  // The queue holds a reference to the socket, so it is valid even if the server (or worker) has
+  // stopped meanwhile
+  WakeupSocket * wakeup = _wakeup;
+  if (wakeup != NULL) {
+    wakeup->signal();
+  }
+  return true;
+}
+
+/**
+ * Adds the message to the queue, applying the overflow policy if it is full. Returns false if the
+ * message has not been taken.
+ */
+bool WebsocketSendQueue::enqueue(Message * message) {
+  if (_overflowPolicy == OVERFLOW_COALESCE && _latest.load() != NULL) {
+    // Messages that arrive while an earlier one is waiting in _latest replace it, so that they are
+    // not sent before it
+    delete _latest.exchange(message);
+    return true;
+  }
+  // With OVERFLOW_DROP_OLDEST, another producer may take the space that has just been made, so the
+  // attempt is repeated a few times
+  for (int attempt = 0; attempt < 4; attempt++) {
+    if (_messages.push(message)) {
+      return true;
+    }
+    if (_overflowPolicy == OVERFLOW_COALESCE) {
+      delete _latest.exchange(message);
+      return true;
+    }
+    if (_overflowPolicy != OVERFLOW_DROP_OLDEST) {
+      break;
+    }
+    Message * oldest;
+    if (_messages.pop(oldest)) {
+      delete oldest;
+    }
+  }
+  HTTPS_LOGD("Websocket send queue is full, dropping message");
+  return false;
+}
+
+/**
+ * Returns true once the websocket has been closed. Further messages are discarded then, and the task
+ * should release() the queue.
+ */
+bool WebsocketSendQueue::isClosed() {
+  return _closed;
+}
+
+/**
+ * Adds a reference, e.g. to pass the queue on to a further task. Only valid while holding a reference.
+ */
+void WebsocketSendQueue::retain() {
+  _refCount++;
+}
+
+/**
+ * Drops one reference. The last one deletes the object and the messages that have not been sent.
+ */
+void WebsocketSendQueue::release() {
+  if (_refCount.fetch_sub(1) == 1) {
+    delete this;
+  }
+}
+
+/**
+ * Sets the socket that is signalled for new messages. Called by the handler. The queue keeps a
+ * reference to it until it is deleted, because producers may still signal it after the websocket has
+ * been closed.
+ */
+void WebsocketSendQueue::setWakeupSocket(WakeupSocket * wakeup) {
+  if (wakeup != NULL) {
+    wakeup->retain();
+  }
+  WakeupSocket * previous = _wakeup.exchange(wakeup);
+  if (previous != NULL) {
+    previous->release();
+  }
+}
+
+/**
+ * Discards further messages. Called by the handler when the websocket is closed.
+ */
+void WebsocketSendQueue::close() {
+  _closed = true;
+}
+
+/**
+ * Returns the next message to send without removing it, or NULL. Only called by the handler.
+ */
+WebsocketSendQueue::Message * WebsocketSendQueue::front() {
+  if (_front == NULL) {
+    if (!_messages.pop(_front)) {
+      // The message that did not fit is the most recent one, so it is sent after the queue has been
+      // drained
+      _front = _latest.exchange(NULL);
+    }
+  }
+  return _front;
+}
+
+/**
+ * Removes the message returned by front() after it has been sent. Only called by the handler.
+ */
+void WebsocketSendQueue::popFront() {
+  delete _front;
+  _front = NULL;
+}
+
+} /* namespace httpsserver */
@@ -0,0 +1,82 @@
+#ifndef SRC_WEBSOCKETSENDQUEUE_HPP_
+#define SRC_WEBSOCKETSENDQUEUE_HPP_
+
+#include <Arduino.h>
+#include <string>
+// Arduino declares it's own min max, incompatible with the stl...
+#undef min
+#undef max
+#include <atomic>
+
+#include "HTTPSServerConstants.hpp"
+#include "LockFreeQueue.hpp"
+#include "WakeupSocket.hpp"
+
+namespace httpsserver {
+
+/**
+ * \brief Queue of messages that other tasks send through a websocket
+ *
+ * WebsocketHandler::send() may only be called from the task that processes the connection. Other tasks
+ * (e.g. one that reads a sensor) get a queue from WebsocketHandler::createSendQueue() instead and call
+ * send() on it. Any number of tasks may do so concurrently without blocking, the server frames the
+ * messages and sends them as soon as the output queue of the connection has room.
+ *
+ * The queue holds up to depth messages. What happens to further messages depends on the policy:
+ *
+ * - OVERFLOW_DROP_NEWEST: send() returns false and the message is discarded.
+ * - OVERFLOW_DROP_OLDEST: The oldest queued message is discarded to make room.
+ * - OVERFLOW_COALESCE: The message replaces the previous message that did not fit, so only the most
+ *   recent one is sent after the queued ones. Useful for values where only the latest one matters.
+ *
+ * The queue is reference counted. Each task that uses it has to call release() once it is done with
+ * it, e.g. after send() has returned false because the websocket has been closed.
+ */
+class WebsocketSendQueue {
+public:
+  static const uint8_t OVERFLOW_DROP_NEWEST = 0;
+  static const uint8_t OVERFLOW_DROP_OLDEST = 1;
+  static const uint8_t OVERFLOW_COALESCE = 2;
+
+  bool send(std::string const &data, uint8_t sendType);
+  bool send(const uint8_t *data, uint16_t length, uint8_t sendType);
+  bool isClosed();
+
+  void retain();
+  void release();
+
+private:
+  friend class WebsocketHandler;
+
+  struct Message {
+    uint8_t sendType;
+    std::string data;
+  };
+
+  WebsocketSendQueue(size_t depth, uint8_t overflowPolicy);
+  virtual ~WebsocketSendQueue();
+
+  bool enqueue(Message * message);
+  void setWakeupSocket(WakeupSocket * wakeup);
+  void close();
+  Message * front();
+  void popFront();
+
+  LockFreeQueue<Message *> _messages;
+  uint8_t _overflowPolicy;
+  // Most recent message that did not fit into the queue (OVERFLOW_COALESCE only), or NULL
+  std::atomic<Message *> _latest;
+  // Next message to send, taken from the queue by the server but not sent yet, or NULL
+  Message * _front;
+
+  std::atomic<bool> _closed;
+  std::atomic<uint8_t> _refCount;
+
+  // Signalled when a message has been queued, to wake up the task that processes the connection.
+  // Retained as long as the queue exists
+  std::atomic<WakeupSocket *> _wakeup;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_WEBSOCKETSENDQUEUE_HPP_ */
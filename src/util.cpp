@@ -3,11 +3,15 @@
 namespace httpsserver {
 
 uint32_t parseUInt(std::string const &s, uint32_t max) {
+  return parseUInt(s.data(), s.size(), max);
+}
+
+uint32_t parseUInt(const char * s, size_t length, uint32_t max) {
   uint32_t i = 0; // value
 
   // Check sign
   size_t x = 0;
-  if (s[0]=='+') {
+  if (length > 0 && s[0]=='+') {
     x = 1;
   }
 
@@ -15,7 +19,7 @@ uint32_t parseUInt(std::string const &s, uint32_t max) {
   max/=10;
 
   // Convert by base 10
-  for(; x < s.size(); x++) {
+  for(; x < length; x++) {
     char c = s[x];
     if (i < max) {
       if (c >= '0' && c<='9') {
@@ -40,21 +44,73 @@ int32_t parseInt(std::string const &s) {
 }
 
 std::string intToString(int i) {
-  if (i==0) {
-    return "0";
+  // Enough for the digits of a 32 bit integer and the sign. The digits are written from the end,
+  // so no floating point math is required to count them in advance
+  char c[12];
+  char * start = c + sizeof(c);
+  uint32_t v = (i < 0 ? -(uint32_t)i : (uint32_t)i);
+  do {
+    *(--start) = '0' + (v % 10);
+    v /= 10;
+  } while (v > 0);
+  if (i < 0) {
+    *(--start) = '-';
   }
-  // We need this much digits
-  int digits = ceil(log10(i+1));
-  char c[digits+1];
-  c[digits] = '\0';
 
-  for(int x = digits-1; x >= 0; x--) {
-    char v = (i%10);
-    c[x] = '0' + v;
-    i = (i-v)/10;
+  return std::string(start, c + sizeof(c) - start);
+}
+
+/**
+ * Returns true if the Accept-Encoding header allows the given content coding. A coding with a weight
+ * of zero (like "gzip;q=0") is not acceptable.
+ */
+bool acceptsEncoding(StringView const &acceptEncoding, const char * encoding) {
+  size_t start = 0;
+  while (start < acceptEncoding.length()) {
+    size_t end = acceptEncoding.find(',', start);
+    if (end == StringView::npos) {
+      end = acceptEncoding.length();
+    }
+    StringView token = acceptEncoding.substr(start, end - start);
+    size_t semicolon = token.find(';');
+    if (token.substr(0, semicolon).trim().equalsIgnoreCase(encoding)) {
+      if (semicolon == StringView::npos) {
+        return true;
+      }
+      // A weight of zero (like "q=0" or "q=0.000") means "not acceptable"
+      StringView params = token.substr(semicolon + 1).trim();
+      if (params.length() < 3 || (params[0] != 'q' && params[0] != 'Q') || params[1] != '=') {
+        return true;
+      }
+      for (size_t i = 2; i < params.length(); i++) {
+        if (params[i] != '0' && params[i] != '.') {
+          return true;
+        }
+      }
+      return false;
+    }
+    start = end + 1;
   }
+  return false;
+}
 
-  return std::string(c);
+/**
+ * Returns true if the comma-separated list (like "keep-alive, Upgrade") contains the token. Tokens
+ * are compared case-insensitive.
+ */
+bool containsToken(StringView const &list, const char * token) {
+  size_t start = 0;
+  while (start < list.length()) {
+    size_t end = list.find(',', start);
+    if (end == StringView::npos) {
+      end = list.length();
+    }
+    if (list.substr(start, end - start).trim().equalsIgnoreCase(token)) {
+      return true;
+    }
+    start = end + 1;
+  }
+  return false;
 }
 
 }
@@ -6,6 +6,8 @@
 #include <cmath>
 #include <string>
 
+#include "StringView.hpp"
+
 namespace httpsserver {
 
 /**
@@ -15,6 +17,11 @@ namespace httpsserver {
  */
 uint32_t parseUInt(std::string const &s, uint32_t max = 0xffffffff);
 
+/**
+ * \brief **Utility function**: Parse an unsigned integer from a character sequence of the given length
+ */
+uint32_t parseUInt(const char * s, size_t length, uint32_t max = 0xffffffff);
+
 /**
  * \brief **Utility function**: Parse a signed integer from a string
  */
@@ -25,6 +32,17 @@ int32_t parseInt(std::string const &s);
  */
 std::string intToString(int i);
 
+/**
+ * \brief **Utility function**: Checks whether an Accept-Encoding header allows a content coding
+ */
+bool acceptsEncoding(StringView const &acceptEncoding, const char * encoding);
+
+/**
+ * \brief **Utility function**: Checks whether a comma-separated header value (like Connection) contains
+ * a token, ignoring case
+ */
+bool containsToken(StringView const &list, const char * token);
+
 }
 
 /**